@@ -11,14 +11,34 @@ const bindings = {
   sources: [
     'src/bindings.cc',
     'src/settings.cc',
+    'src/settings/sampling-policies.cc',
+    'src/settings/adaptive-sampling.cc',
+    'src/settings/decision-stats.cc',
+    'src/settings/signature-cache.cc',
     'src/config.cc',
+    'src/config/settings-snapshot.cc',
+    'src/readiness.cc',
     'src/event.cc',
     'src/event/event-to-string.cc',
     'src/event/event-send.cc',
-    'src/reporter.cc'
+    'src/event/trace-context.cc',
+    'src/event/id-generator.cc',
+    'src/reporter.cc',
+    'src/reporter/span-batch.cc',
+    'src/reporter/txname-cache.cc',
+    'src/reporter/txname-normalizer.cc',
+    'src/reporter/span-histograms.cc',
+    'src/reporter/top-transactions.cc',
+    'src/reporter/exemplars.cc',
+    'src/reporter/flush-async.cc',
+    'src/reporter/pressure.cc',
+    'src/reporter/distributions.cc',
+    'src/reporter/series-cache.cc',
+    'src/reporter/cardinality.cc',
+    'src/reporter/shared-metrics.cc'
   ],
   include: [__dirname, 'src'],
-  libraries: ['oboe'],
+  libraries: ['oboe', 'rt'],
   rpath: '$ORIGIN',
   cflags: ['-Wall', '-Wextra']
 }
@@ -30,7 +50,9 @@ const metrics = {
     'src/metrics/metrics.cc',
     'src/metrics/gc.cc',
     'src/metrics/eventloop.cc',
-    'src/metrics/process.cc'
+    'src/metrics/process.cc',
+    'src/metrics/histogram.cc',
+    'src/metrics/exporter.cc'
   ],
   include: [__dirname, nan],
   libraries: ['oboe'],
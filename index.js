@@ -47,7 +47,10 @@ try {
       module.exports.metrics = {
         start () { return true },
         stop () { return true },
-        getMetrics () { return {} }
+        getMetrics () { return {} },
+        startExporter () { return false },
+        stopExporter () { return false },
+        getExporterStats () { return { running: false, ticks: 0, submitted: 0, failed: 0 } }
       }
     }
 
@@ -69,5 +72,30 @@ try {
     Event.makeFromString = function (string) {
       if (validTraceparent(string)) return Event.makeFromBuffer(Buffer.from(string.replace(/-/g, ''), 'hex'))
     }
+
+    //
+    // read a consistent copy of the settings snapshot from the view
+    // returned by Config.getSettingsSnapshot(). the sequence is odd while
+    // the snapshot is being written so retry until it's even and unchanged.
+    //
+    const Config = module.exports.Config
+    const fields = Config.settingsSnapshotFields
+
+    // pass an object as into to have it filled in and returned rather than
+    // allocating a new one on each read.
+    Config.readSettingsSnapshot = function (view, into) {
+      const settings = into || {}
+      while (true) {
+        const seq = Atomics.load(view, fields.sequence)
+        if (seq & 1) continue
+        settings.tracingMode = view[fields.tracingMode]
+        settings.sampleRate = view[fields.sampleRate]
+        settings.triggerMode = view[fields.triggerMode]
+        settings.flags = view[fields.flags]
+        settings.timestamp = view[fields.timestamp]
+        settings.updates = view[fields.updates]
+        if (Atomics.load(view, fields.sequence) === seq) return settings
+      }
+    }
   }
 }
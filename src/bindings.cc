@@ -1,4 +1,24 @@
 #include "bindings.h"
+#include "reporter/reporter.h"
+#include "settings/settings.h"
+
+//
+// get the environment's instance data, creating it the first time. it's
+// deleted by napi when the environment is torn down.
+//
+InstanceData* instance_data(Napi::Env env) {
+  InstanceData* data = env.GetInstanceData<InstanceData>();
+  if (!data) {
+    data = new InstanceData;
+    env.SetInstanceData(data);
+  }
+  return data;
+}
+
+InstanceData::~InstanceData() {
+  TxnameCache::destroy(txnames);
+  SeriesCache::destroy(series);
+}
 
 //
 // Initialize oboe
@@ -81,6 +101,8 @@ Napi::Value oboeInit(const Napi::CallbackInfo& info) {
       if (maxTransactions.IsNumber()) {
         valid.Set("maxTransactions", maxTransactions);
         options.max_transactions = maxTransactions.ToNumber().Int64Value();
+        // the final transaction names are bounded by max_transactions.
+        TxnameCache::setCapacity(options.max_transactions);
       }
     }
     if (o.Has("maxFlushWaitTime")) {
@@ -224,6 +246,96 @@ Napi::Value oboeInit(const Napi::CallbackInfo& info) {
       }
     }
 
+    // bindings-only options. these take effect even if oboe is already
+    // initialized.
+    if (o.Has("txnameNormalizer")) {
+      Napi::Value txnameNormalizer = o.Get("txnameNormalizer");
+      processed.Set("txnameNormalizer", txnameNormalizer);
+      if (TxnameNormalizer::configure(txnameNormalizer)) {
+        valid.Set("txnameNormalizer", txnameNormalizer);
+      }
+    }
+    if (o.Has("spanHistograms")) {
+      Napi::Value spanHistograms = o.Get("spanHistograms");
+      processed.Set("spanHistograms", spanHistograms);
+      if (SpanHistograms::configure(spanHistograms)) {
+        valid.Set("spanHistograms", spanHistograms);
+      }
+    }
+    if (o.Has("topTransactions")) {
+      Napi::Value topTransactions = o.Get("topTransactions");
+      processed.Set("topTransactions", topTransactions);
+      if (TopTransactions::configure(topTransactions)) {
+        valid.Set("topTransactions", topTransactions);
+      }
+    }
+    if (o.Has("exemplars")) {
+      Napi::Value exemplars = o.Get("exemplars");
+      processed.Set("exemplars", exemplars);
+      if (Exemplars::configure(exemplars)) {
+        valid.Set("exemplars", exemplars);
+      }
+    }
+    if (o.Has("distributions")) {
+      Napi::Value distributions = o.Get("distributions");
+      processed.Set("distributions", distributions);
+      if (Distributions::configure(distributions)) {
+        valid.Set("distributions", distributions);
+      }
+    }
+    if (o.Has("metricSeriesCache")) {
+      Napi::Value metricSeriesCache = o.Get("metricSeriesCache");
+      processed.Set("metricSeriesCache", metricSeriesCache);
+      if (SeriesCache::configure(metricSeriesCache)) {
+        valid.Set("metricSeriesCache", metricSeriesCache);
+      }
+    }
+    if (o.Has("metricCardinality")) {
+      Napi::Value metricCardinality = o.Get("metricCardinality");
+      processed.Set("metricCardinality", metricCardinality);
+      if (Cardinality::configure(metricCardinality)) {
+        valid.Set("metricCardinality", metricCardinality);
+      }
+    }
+    if (o.Has("sharedMetrics")) {
+      Napi::Value sharedMetrics = o.Get("sharedMetrics");
+      processed.Set("sharedMetrics", sharedMetrics);
+      if (SharedMetrics::configure(sharedMetrics)) {
+        valid.Set("sharedMetrics", sharedMetrics);
+      }
+    }
+    if (o.Has("backpressure")) {
+      Napi::Value backpressure = o.Get("backpressure");
+      processed.Set("backpressure", backpressure);
+      if (Pressure::configure(backpressure)) {
+        valid.Set("backpressure", backpressure);
+      }
+    }
+
+    if (o.Has("adaptiveSampling")) {
+      Napi::Value adaptiveSampling = o.Get("adaptiveSampling");
+      processed.Set("adaptiveSampling", adaptiveSampling);
+      if (AdaptiveSampling::configure(adaptiveSampling)) {
+        valid.Set("adaptiveSampling", adaptiveSampling);
+      }
+    }
+
+    if (o.Has("signatureCache")) {
+      Napi::Value signatureCache = o.Get("signatureCache");
+      processed.Set("signatureCache", signatureCache);
+      if (SignatureCache::configure(signatureCache)) {
+        valid.Set("signatureCache", signatureCache);
+      }
+    }
+
+    if (o.Has("fastIds")) {
+      Napi::Value fastIds = o.Get("fastIds");
+      processed.Set("fastIds", fastIds);
+      if (IdGenerator::configure(fastIds)) {
+        valid.Set("fastIds", fastIds);
+      }
+    }
+
     if (skipInit) {
       return env.Null();
     }
@@ -297,6 +409,7 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
   exports = Settings::Init(env, exports);
   exports = Event::Init(env, exports);
   exports = Config::Init(env, exports);
+  exports = Readiness::Init(env, exports);
 
   return exports;
 
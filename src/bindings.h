@@ -9,6 +9,58 @@
 
 typedef int (*send_generic_span_t) (char*, uint16_t, oboe_span_params_t*);
 
+namespace TxnameCache {
+  struct Cache;
+  void destroy(Cache*);
+}
+namespace SeriesCache {
+  struct Cache;
+  void destroy(Cache*);
+}
+namespace SettingsSnapshot {
+  struct Watcher;
+}
+
+//
+// InstanceData - state kept for each environment, the main thread and each
+// worker, that loads the addon. napi has a single instance data slot per
+// environment so everything that needs one shares this.
+//
+struct InstanceData {
+  TxnameCache::Cache* txnames = nullptr;
+  // the strings cached by txnames, an Array.
+  Napi::ObjectReference txname_strings;
+  SeriesCache::Cache* series = nullptr;
+  Napi::Reference<Napi::Int32Array> settings_snapshot;
+  // freed by its own cleanup hook.
+  SettingsSnapshot::Watcher* settings_watcher = nullptr;
+
+  ~InstanceData();
+};
+
+InstanceData* instance_data(Napi::Env);
+
+//
+// TraceContext - W3C traceparent and tracestate parsing and formatting.
+//
+namespace TraceContext {
+  const size_t kTraceparentLength = 55;
+
+  bool getBytes(Napi::Value, const char*&, size_t&);
+  bool decodeTraceparent(const char*, size_t, oboe_metadata_t&);
+  size_t encodeTraceparent(const oboe_metadata_t&, char*);
+  bool findSwMember(const char*, size_t, const char*&, size_t&);
+}
+
+//
+// IdGenerator - random trace and span ids from a fast per-thread generator.
+//
+namespace IdGenerator {
+  void fill(uint8_t*, size_t);
+  void randomMetadata(oboe_metadata_t&);
+  bool configure(Napi::Value);
+}
+
 //
 // Event - work with oboe's oboe_event_t structure.
 //
@@ -53,6 +105,11 @@ private:
   uint64_t creation_time;   // time event was created
   uint64_t send_time;       // time event was sent
 
+  // used to prioritize events under back-pressure. non-root (has an edge)
+  // info events are the first to be dropped.
+  bool has_edge;
+  bool is_info;
+
  public:
   // methods that manipulate the instance's oboe_event_t
   Napi::Value addInfo(const Napi::CallbackInfo& info);
@@ -80,6 +137,12 @@ private:
   // parts.
   const static size_t fmtBufferSize = OBOE_MAX_METADATA_PACK_LEN + 3;
 
+  // W3C trace context headers
+  Napi::Value toTraceparent(const Napi::CallbackInfo& info);
+  Napi::Value toTracestate(const Napi::CallbackInfo& info);
+  Napi::Value writeTraceparent(const Napi::CallbackInfo& info);
+  Napi::Value writeTracestate(const Napi::CallbackInfo& info);
+
   Napi::Value sendStatus(const Napi::CallbackInfo& info);
   Napi::Value sendReport(const Napi::CallbackInfo& info);
 
@@ -90,10 +153,16 @@ public:
   // methods that create an invalid event that contains only metadata.
   static Napi::Value makeRandom(const Napi::CallbackInfo& info);
   static Napi::Value makeFromBuffer(const Napi::CallbackInfo& info);
+  static Napi::Value parseTraceContext(const Napi::CallbackInfo& info);
+  static Napi::Value makeRandomBatch(const Napi::CallbackInfo& info);
+  static Napi::Value benchmarkRandomIds(const Napi::CallbackInfo& info);
 
   // C++ instanceof equivalent
   static bool isEvent(Napi::Object);
 
+  // C++ method to get the hex trace id of an Event if it is sampled.
+  static bool getSampledTraceId(Napi::Object, std::string&);
+
   // C++ method to create an unitialized, invalid oboe event.
   static Napi::Object makeFromOboeMetadata(const Napi::Env env, oboe_metadata_t& omd);
 
@@ -122,6 +191,21 @@ namespace Reporter {
   Napi::Object Init(Napi::Env, Napi::Object);
 }
 
+//
+// Readiness provides asynchronous versions of isReadyToSample().
+//
+namespace Readiness {
+  Napi::Object Init(Napi::Env, Napi::Object);
+}
+
+//
+// SettingsSnapshot keeps oboe's settings in memory JavaScript reads directly.
+//
+namespace SettingsSnapshot {
+  Napi::Value get(const Napi::CallbackInfo&);
+  Napi::Object fieldPositions(Napi::Env);
+}
+
 //
 // Config provides the getVersionString function.
 //
@@ -59,6 +59,8 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
   module.Set("getVersionString", Napi::Function::New(env, getVersionString));
   module.Set("getSettings", Napi::Function::New(env, getConfigSettings));
   module.Set("getStats", Napi::Function::New(env, getStats));
+  module.Set("getSettingsSnapshot", Napi::Function::New(env, SettingsSnapshot::get));
+  module.Set("settingsSnapshotFields", SettingsSnapshot::fieldPositions(env));
 
   exports.Set("Config", module);
 
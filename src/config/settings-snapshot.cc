@@ -0,0 +1,200 @@
+#include "bindings.h"
+#include "uv.h"
+#include <atomic>
+
+//
+// A snapshot of oboe's settings config in memory that JavaScript reads
+// through an Int32Array, without a call into the addon.
+//
+// A native watcher on an unref'd timer compares oboe_settings_cfg_get() to
+// the snapshot and rewrites it when something changed. Writes are guarded
+// by a seqlock: the sequence is odd while the fields are being written, so
+// a reader that sees an odd sequence, or a sequence that changed while it
+// read, reads again. Config.readSettingsSnapshot() in index.js does that.
+//
+// The memory is static so every worker thread that loads the addon gets a
+// view of the same snapshot. Each environment that gets a view runs its own
+// timer but only one, the writer, refreshes the snapshot. When the writer
+// is torn down or stops checking, the next environment whose timer fires
+// takes over, so the snapshot keeps being refreshed while any environment
+// is checking.
+//
+namespace SettingsSnapshot {
+
+enum Field {
+  kSequence,
+  kTracingMode,
+  kSampleRate,
+  kTriggerMode,
+  kFlags,
+  kTimestamp,
+  kUpdates,
+  kFieldCount
+};
+
+static const char* field_names[kFieldCount] = {
+  "sequence", "tracingMode", "sampleRate", "triggerMode", "flags", "timestamp", "updates"
+};
+
+static std::atomic<int32_t> fields[kFieldCount];
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t), "atomics must be plain ints");
+
+// the environment that writes the snapshot, null if none.
+static std::atomic<napi_env> writer(nullptr);
+
+//
+// an environment's timer. it's allocated with the timer and freed by the
+// environment's cleanup hook; the timer is freed when it's closed.
+//
+struct Watcher {
+  napi_env env;
+  uv_timer_t* timer;
+};
+
+//
+// copy oboe's settings to the snapshot if they changed.
+//
+static void refresh() {
+  int32_t values[kFieldCount] = {0};
+  oboe_settings_cfg_t* cfg = oboe_settings_cfg_get();
+  if (cfg != NULL) {
+    values[kTracingMode] = cfg->tracing_mode;
+    values[kSampleRate] = cfg->sample_rate;
+    values[kTriggerMode] = cfg->trigger_mode;
+    if (cfg->settings) {
+      values[kFlags] = cfg->settings->flags;
+      values[kTimestamp] = cfg->settings->timestamp;
+    }
+  } else {
+    values[kTracingMode] = -1;
+    values[kSampleRate] = -1;
+    values[kTriggerMode] = -1;
+  }
+
+  bool changed = false;
+  for (int i = kTracingMode; i < kUpdates; i++) {
+    changed |= fields[i].load(std::memory_order_relaxed) != values[i];
+  }
+  if (!changed) {
+    return;
+  }
+
+  int32_t seq = fields[kSequence].load(std::memory_order_relaxed);
+  fields[kSequence].store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (int i = kTracingMode; i < kUpdates; i++) {
+    fields[i].store(values[i], std::memory_order_relaxed);
+  }
+  fields[kUpdates].store(fields[kUpdates].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  fields[kSequence].store(seq + 2, std::memory_order_release);
+}
+
+//
+// become the writer if there isn't one. returns true if env is the writer.
+//
+static bool claim(napi_env env) {
+  napi_env expected = nullptr;
+  return writer.compare_exchange_strong(expected, env) || expected == env;
+}
+
+static void release(napi_env env) {
+  napi_env expected = env;
+  writer.compare_exchange_strong(expected, nullptr);
+}
+
+static void refresh_cb(uv_timer_t* handle) {
+  Watcher* w = static_cast<Watcher*>(handle->data);
+  if (claim(w->env)) {
+    refresh();
+  }
+}
+
+static void stop_watcher(void* arg) {
+  Watcher* w = static_cast<Watcher*>(arg);
+  uv_timer_stop(w->timer);
+  uv_close(reinterpret_cast<uv_handle_t*>(w->timer), [](uv_handle_t* handle) {
+    delete reinterpret_cast<uv_timer_t*>(handle);
+  });
+  release(w->env);
+  instance_data(w->env)->settings_watcher = nullptr;
+  delete w;
+}
+
+//
+// JavaScript callable
+//
+// getSettingsSnapshot(options) returns an Int32Array view of the snapshot.
+// the positions of the fields are in Config.settingsSnapshotFields.
+//
+// options.interval - milliseconds between checks for new settings (default
+//                    1000). 0 stops checking.
+//
+// options.writer - set to true if this thread is the one refreshing the
+//                  snapshot.
+//
+// every thread's timer checks at its own interval but only one thread
+// refreshes the snapshot at a time. a thread that stops checking, or goes
+// away, hands off to the next thread whose timer fires.
+//
+Napi::Value get(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  int64_t interval = 1000;
+  if (info.Length() >= 1 && info[0].IsObject()) {
+    Napi::Value v = info[0].ToObject().Get("interval");
+    if (v.IsNumber()) {
+      interval = v.As<Napi::Number>().Int64Value();
+    } else if (!v.IsUndefined()) {
+      Napi::TypeError::New(env, "getSettingsSnapshot() - interval must be a number").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+
+  InstanceData* data = instance_data(env);
+  Watcher* w = data->settings_watcher;
+  if (!w) {
+    uv_loop_t* loop;
+    napi_get_uv_event_loop(env, &loop);
+    w = new Watcher{env, new uv_timer_t};
+    uv_timer_init(loop, w->timer);
+    w->timer->data = w;
+    // don't keep the process alive just to watch the settings.
+    uv_unref(reinterpret_cast<uv_handle_t*>(w->timer));
+    napi_add_env_cleanup_hook(env, stop_watcher, w);
+    data->settings_watcher = w;
+  }
+
+  uv_timer_stop(w->timer);
+  bool is_writer = false;
+  if (interval > 0) {
+    uv_timer_start(w->timer, refresh_cb, interval, interval);
+    is_writer = claim(env);
+  } else {
+    release(env);
+  }
+  if (is_writer) {
+    refresh();
+  }
+  if (info.Length() >= 1 && info[0].IsObject()) {
+    info[0].ToObject().Set("writer", Napi::Boolean::New(env, is_writer));
+  }
+
+  // each environment gets one view. the memory is static so there is
+  // nothing to finalize.
+  if (data->settings_snapshot.IsEmpty()) {
+    Napi::ArrayBuffer buffer = Napi::ArrayBuffer::New(env, fields, sizeof(fields));
+    data->settings_snapshot = Napi::Persistent(Napi::Int32Array::New(env, kFieldCount, buffer, 0));
+  }
+  return data->settings_snapshot.Value();
+}
+
+Napi::Object fieldPositions(Napi::Env env) {
+  Napi::Object o = Napi::Object::New(env);
+  for (int i = 0; i < kFieldCount; i++) {
+    o.Set(field_names[i], Napi::Number::New(env, i));
+  }
+  o.Set("length", Napi::Number::New(env, kFieldCount));
+  return o;
+}
+
+} // end namespace SettingsSnapshot
@@ -57,6 +57,8 @@ Event::Event(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Event>(info) {
     total_bytes_alloc += bytes_allocated;
     creation_time = uv_hrtime();
     send_time = 0;
+    has_edge = false;
+    is_info = false;
 
     oboe_metadata_t omd;
 
@@ -114,6 +116,7 @@ Event::Event(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Event>(info) {
         Napi::Error::New(env, "oboe.add_edge: " + std::to_string(edge_status)).ThrowAsJavaScriptException();
         return;
       }
+      has_edge = true;
     }
 }
 
@@ -140,8 +143,7 @@ Napi::Value Event::makeRandom(const Napi::CallbackInfo& info) {
   oboe_event_t* oe = &Napi::ObjectWrap<Event>::Unwrap(event)->event;
 
   // fill it with random data
-  oboe_metadata_init(&oe->metadata);
-  oboe_metadata_random(&oe->metadata);
+  IdGenerator::randomMetadata(oe->metadata);
 
   // set or clear the sample flag appropriately if an argument specified.
   if (info.Length() == 1) {
@@ -266,6 +268,7 @@ Napi::Value Event::addEdge(const Napi::CallbackInfo& info) {
         Napi::Error::New(env, "Failed to add edge").ThrowAsJavaScriptException();
         return env.Undefined();
     }
+    has_edge = true;
 
     return Napi::Boolean::New(env, true);
 }
@@ -315,6 +318,10 @@ Napi::Value Event::addInfo(const Napi::CallbackInfo& info) {
       // binary is not really binary, it's utf8. but we don't want any embedded nulls so
       // just use oboe_event_add_info.
       status = oboe_event_add_info(event, key.c_str(), str.c_str());
+      // remember info events for back-pressure decisions.
+      if (key == "Label") {
+        is_info = str == "info";
+      }
     } else {
       Napi::TypeError::New(env, "Value must be a boolean, string or number")
           .ThrowAsJavaScriptException();
@@ -411,6 +418,29 @@ inline bool Event::isEvent(Napi::Object o) {
   return o.InstanceOf(constructor.Value());
 }
 
+//
+// C++ callable method to get the lowercase hex trace id of a JavaScript
+// Event instance. returns false if the object isn't an Event or the event
+// isn't sampled.
+//
+bool Event::getSampledTraceId(Napi::Object o, std::string& trace_id) {
+  if (!Event::isEvent(o)) {
+    return false;
+  }
+  const oboe_metadata_t& md = Napi::ObjectWrap<Event>::Unwrap(o)->event.metadata;
+  if (!(md.flags & XTR_FLAGS_SAMPLED)) {
+    return false;
+  }
+
+  static const char hex[] = "0123456789abcdef";
+  trace_id.clear();
+  for (size_t i = 0; i < md.task_len && i < OBOE_MAX_TASK_ID_LEN; i++) {
+    trace_id += hex[md.ids.task_id[i] >> 4];
+    trace_id += hex[md.ids.task_id[i] & 0xF];
+  }
+  return !trace_id.empty();
+}
+
 size_t Event::total_created;
 size_t Event::total_destroyed;
 size_t Event::ptotal_destroyed;
@@ -451,6 +481,10 @@ Napi::Object Event::Init(Napi::Env env, Napi::Object exports) {
         InstanceMethod("addInfo", &Event::addInfo),
         InstanceMethod("addEdge", &Event::addEdge),
         InstanceMethod("toString", &Event::toString),
+        InstanceMethod("toTraceparent", &Event::toTraceparent),
+        InstanceMethod("toTracestate", &Event::toTracestate),
+        InstanceMethod("writeTraceparent", &Event::writeTraceparent),
+        InstanceMethod("writeTracestate", &Event::writeTracestate),
         InstanceMethod("getSampleFlag", &Event::getSampleFlag),
         InstanceMethod("sendReport", &Event::sendReport),
         InstanceMethod("sendStatus", &Event::sendStatus),
@@ -461,6 +495,9 @@ Napi::Object Event::Init(Napi::Env env, Napi::Object exports) {
 
         StaticMethod("makeRandom", &Event::makeRandom),
         StaticMethod("makeFromBuffer", &Event::makeFromBuffer),
+        StaticMethod("parseTraceContext", &Event::parseTraceContext),
+        StaticMethod("makeRandomBatch", &Event::makeRandomBatch),
+        StaticMethod("benchmarkRandomIds", &Event::benchmarkRandomIds),
         StaticMethod("getEventStats", &Event::getEventStats),
       }
     );
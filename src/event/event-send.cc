@@ -1,4 +1,5 @@
 #include "bindings.h"
+#include "reporter/reporter.h"
 #include "uv.h"
 
 //
@@ -26,6 +27,10 @@ int Event::send_event_x(int channel) {
   if (!initialized) {
     return -2000;
   }
+  // under back-pressure drop the event before doing any encoding work.
+  if (Pressure::dropEvent(channel, has_edge && is_info)) {
+    return Pressure::kEventDropped;
+  }
   // fake up metadata so oboe can check it. change the op_id so it doesn't
   // match the event's in oboe's check.
   oboe_metadata_t omd = this->event.metadata;
@@ -0,0 +1,251 @@
+#include "bindings.h"
+#include "uv.h"
+#include <pthread.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <random>
+
+//
+// Fast random trace and span ids.
+//
+// oboe_metadata_random() reads from the system's entropy source for every
+// id. When enabled with the oboeInit() fastIds option ids come from a
+// per-thread xoshiro256** generator instead. Each thread's generator is
+// seeded from the OS, reseeded after a configurable number of outputs and
+// reseeded in a child process after fork() so a child never repeats its
+// parent's ids.
+//
+// Random bytes are generated a block at a time into a per-thread pool so
+// the cost of the generator is amortized over many ids.
+//
+namespace IdGenerator {
+
+static std::atomic<bool> enabled(false);
+static std::atomic<uint64_t> reseed_interval(UINT64_C(1) << 20);
+
+// bumped in the child after a fork so every thread reseeds.
+static std::atomic<uint64_t> generation(1);
+
+const size_t kPoolBytes = 4096;
+
+struct State {
+  uint64_t s[4];
+  uint64_t generation = 0;
+  uint64_t outputs = 0;
+  uint8_t pool[kPoolBytes];
+  size_t pool_used = kPoolBytes;
+};
+
+static thread_local State state;
+
+static inline uint64_t rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+// xoshiro256** by David Blackman and Sebastiano Vigna, public domain.
+static inline uint64_t next(State& st) {
+  uint64_t* s = st.s;
+  const uint64_t result = rotl(s[1] * 5, 7) * 9;
+  const uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+  return result;
+}
+
+static void seed(State& st) {
+  std::random_device rd;
+  do {
+    for (int i = 0; i < 4; i++) {
+      st.s[i] = (static_cast<uint64_t>(rd()) << 32) ^ rd();
+    }
+    // the state must not be all zeros.
+  } while (!(st.s[0] | st.s[1] | st.s[2] | st.s[3]));
+  st.generation = generation.load(std::memory_order_relaxed);
+  st.outputs = 0;
+  st.pool_used = kPoolBytes;
+}
+
+static void after_fork_child() {
+  generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void refill(State& st) {
+  if (st.generation != generation.load(std::memory_order_relaxed) || st.outputs >= reseed_interval) {
+    seed(st);
+  }
+  for (size_t i = 0; i < kPoolBytes; i += sizeof(uint64_t)) {
+    uint64_t r = next(st);
+    memcpy(st.pool + i, &r, sizeof(r));
+  }
+  st.outputs += kPoolBytes / sizeof(uint64_t);
+  st.pool_used = 0;
+}
+
+//
+// fill out with n random bytes.
+//
+void fill(uint8_t* out, size_t n) {
+  State& st = state;
+  // a fork discards the pool too.
+  if (st.generation != generation.load(std::memory_order_relaxed)) {
+    st.pool_used = kPoolBytes;
+  }
+  while (n) {
+    if (st.pool_used == kPoolBytes) {
+      refill(st);
+    }
+    size_t take = std::min(n, kPoolBytes - st.pool_used);
+    memcpy(out, st.pool + st.pool_used, take);
+    st.pool_used += take;
+    out += take;
+    n -= take;
+  }
+}
+
+static bool is_zero(const uint8_t* bytes, size_t n) {
+  uint8_t any = 0;
+  for (size_t i = 0; i < n; i++) {
+    any |= bytes[i];
+  }
+  return !any;
+}
+
+//
+// initialize metadata with random ids from the fast generator.
+//
+static void fast_metadata(oboe_metadata_t& omd) {
+  oboe_metadata_init(&omd);
+  // all zero ids are invalid.
+  do {
+    fill(omd.ids.task_id, OBOE_TASK_ID_TRACEPARENT_LEN);
+  } while (is_zero(omd.ids.task_id, OBOE_TASK_ID_TRACEPARENT_LEN));
+  do {
+    fill(omd.ids.op_id, OBOE_MAX_OP_ID_LEN);
+  } while (is_zero(omd.ids.op_id, OBOE_MAX_OP_ID_LEN));
+  omd.task_len = OBOE_TASK_ID_TRACEPARENT_LEN;
+  omd.op_len = OBOE_MAX_OP_ID_LEN;
+}
+
+//
+// initialize metadata with random ids, using the fast generator if it's
+// enabled or oboe_metadata_random() if not.
+//
+void randomMetadata(oboe_metadata_t& omd) {
+  if (enabled) {
+    fast_metadata(omd);
+    return;
+  }
+  oboe_metadata_init(&omd);
+  oboe_metadata_random(&omd);
+}
+
+//
+// configure from the oboeInit() fastIds option which is either a boolean
+// or an object:
+//
+// options.reseedInterval - 64 bit outputs before a thread's generator is
+//                          reseeded from the OS (default 1048576)
+//
+bool configure(Napi::Value v) {
+  static std::atomic<bool> registered(false);
+  if (v.IsBoolean()) {
+    enabled = v.As<Napi::Boolean>().Value();
+  } else if (v.IsObject() && !v.IsArray()) {
+    Napi::Value r = v.As<Napi::Object>().Get("reseedInterval");
+    if (!r.IsUndefined()) {
+      if (!r.IsNumber() || r.As<Napi::Number>().Int64Value() < 1) {
+        return false;
+      }
+      reseed_interval = r.As<Napi::Number>().Int64Value();
+    }
+    enabled = true;
+  } else {
+    return false;
+  }
+  if (enabled && !registered.exchange(true)) {
+    pthread_atfork(nullptr, nullptr, after_fork_child);
+  }
+  // reseed with the new settings.
+  generation.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+} // end namespace IdGenerator
+
+// the layout of Event.makeFromBuffer(): a version byte, the trace id, the
+// parent id and the flags.
+const size_t kPackedIdsLength = 1 + OBOE_TASK_ID_TRACEPARENT_LEN + OBOE_MAX_OP_ID_LEN + 1;
+
+//
+// Event.makeRandomBatch(count, sampled)
+//
+// generate count sets of random ids at once. returns a Buffer with 26
+// bytes for each, the layout Event.makeFromBuffer() takes, so events can be
+// made from them as they're needed. the sample flag is set if sampled is
+// truthy. the ids come from the same generator as makeRandom().
+//
+Napi::Value Event::makeRandomBatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsNumber() || info[0].As<Napi::Number>().Int64Value() < 0) {
+    Napi::TypeError::New(env, "makeRandomBatch() - count must be a non-negative number").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  size_t count = info[0].As<Napi::Number>().Int64Value();
+  bool sampled = info.Length() >= 2 && info[1].ToBoolean().Value();
+
+  Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(env, count * kPackedIdsLength);
+  uint8_t* p = buffer.Data();
+  oboe_metadata_t omd;
+  for (size_t i = 0; i < count; i++, p += kPackedIdsLength) {
+    IdGenerator::randomMetadata(omd);
+    p[0] = 0;
+    memcpy(p + 1, omd.ids.task_id, OBOE_TASK_ID_TRACEPARENT_LEN);
+    memcpy(p + 1 + OBOE_TASK_ID_TRACEPARENT_LEN, omd.ids.op_id, OBOE_MAX_OP_ID_LEN);
+    p[kPackedIdsLength - 1] = sampled ? XTR_FLAGS_SAMPLED : XTR_FLAGS_NOT_SAMPLED;
+  }
+
+  return buffer;
+}
+
+//
+// Event.benchmarkRandomIds(count)
+//
+// time generating count sets of ids with oboe_metadata_random() and with
+// the fast generator. returns {oboe, fast} in nanoseconds per id.
+//
+Napi::Value Event::benchmarkRandomIds(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  int64_t count = 100000;
+  if (info.Length() >= 1 && info[0].IsNumber()) {
+    count = info[0].As<Napi::Number>().Int64Value();
+  }
+  if (count < 1) {
+    count = 1;
+  }
+
+  oboe_metadata_t omd;
+  uint64_t start = uv_hrtime();
+  for (int64_t i = 0; i < count; i++) {
+    oboe_metadata_init(&omd);
+    oboe_metadata_random(&omd);
+  }
+  uint64_t oboe_ns = uv_hrtime() - start;
+
+  start = uv_hrtime();
+  for (int64_t i = 0; i < count; i++) {
+    IdGenerator::fast_metadata(omd);
+  }
+  uint64_t fast_ns = uv_hrtime() - start;
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("oboe", Napi::Number::New(env, static_cast<double>(oboe_ns) / count));
+  o.Set("fast", Napi::Number::New(env, static_cast<double>(fast_ns) / count));
+  return o;
+}
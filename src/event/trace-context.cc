@@ -0,0 +1,393 @@
+#include "bindings.h"
+#include <cstring>
+
+//
+// W3C trace context codec.
+//
+// Incoming traceparent and tracestate headers are parsed straight from a
+// string, Buffer or Uint8Array and outgoing headers are formatted from an
+// event's metadata into a string or directly into a Buffer.
+//
+// https://www.w3.org/TR/trace-context/
+//
+namespace TraceContext {
+
+//
+// hex digit values. anything that isn't a lowercase hex digit has the 0x10
+// bit set; trace context requires lowercase.
+//
+struct HexValues {
+  uint8_t v[256];
+  HexValues() {
+    for (int i = 0; i < 256; i++) {
+      v[i] = 0x10;
+    }
+    for (int i = 0; i < 10; i++) {
+      v['0' + i] = i;
+    }
+    for (int i = 0; i < 6; i++) {
+      v['a' + i] = 10 + i;
+    }
+  }
+};
+static const HexValues hex_values;
+
+static const char hex_digits[] = "0123456789abcdef";
+
+// most list members kept in an outgoing tracestate, including sw.
+const int kMaxTracestateMembers = 32;
+
+// "sw=" + op id + "-" + flags
+const size_t kSwMemberLength = 3 + 2 * OBOE_MAX_OP_ID_LEN + 1 + 2;
+
+//
+// decode n bytes of hex. there are no branches in the loop so the compiler
+// is free to vectorize it; invalid digits are accumulated and checked once.
+//
+static bool decode_hex(const char* s, size_t n, uint8_t* out) {
+  uint8_t invalid = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint8_t hi = hex_values.v[static_cast<uint8_t>(s[2 * i])];
+    uint8_t lo = hex_values.v[static_cast<uint8_t>(s[2 * i + 1])];
+    invalid |= hi | lo;
+    out[i] = static_cast<uint8_t>((hi << 4) | (lo & 0xf));
+  }
+  return !(invalid & 0x10);
+}
+
+static char* encode_hex(const uint8_t* bytes, size_t n, char* out) {
+  for (size_t i = 0; i < n; i++) {
+    *out++ = hex_digits[bytes[i] >> 4];
+    *out++ = hex_digits[bytes[i] & 0xf];
+  }
+  return out;
+}
+
+//
+// get the bytes of a Buffer or Uint8Array.
+//
+bool getBytes(Napi::Value v, const char*& data, size_t& length) {
+  if (!v.IsTypedArray() || v.As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array) {
+    return false;
+  }
+  Napi::Uint8Array a = v.As<Napi::Uint8Array>();
+  data = reinterpret_cast<const char*>(a.Data());
+  length = a.ElementLength();
+  return true;
+}
+
+//
+// get the bytes of a string, Buffer or Uint8Array. a string is converted
+// into storage. returns false for any other type.
+//
+static bool get_header(Napi::Value v, std::string& storage, const char*& data, size_t& length) {
+  if (getBytes(v, data, length)) {
+    return true;
+  }
+  if (!v.IsString()) {
+    return false;
+  }
+  storage = v.As<Napi::String>();
+  data = storage.data();
+  length = storage.length();
+  return true;
+}
+
+static bool is_zero(const uint8_t* bytes, size_t n) {
+  uint8_t any = 0;
+  for (size_t i = 0; i < n; i++) {
+    any |= bytes[i];
+  }
+  return !any;
+}
+
+//
+// decode a traceparent, version-traceid-parentid-flags, into metadata in a
+// single pass. length is that of the whole header: exactly 55 characters
+// for version 00. a longer header, which is only valid for a later version,
+// must have a '-' after the first 55 characters and that part is decoded.
+// accepts what oboe does: lowercase hex and ids that aren't all zeros.
+//
+bool decodeTraceparent(const char* s, size_t length, oboe_metadata_t& omd) {
+  if (length < kTraceparentLength || s[2] != '-' || s[35] != '-' || s[52] != '-') {
+    return false;
+  }
+  uint8_t version;
+  uint8_t flags;
+  oboe_metadata_init(&omd);
+  bool valid = decode_hex(s, 1, &version)
+    & decode_hex(s + 3, OBOE_TASK_ID_TRACEPARENT_LEN, omd.ids.task_id)
+    & decode_hex(s + 36, OBOE_MAX_OP_ID_LEN, omd.ids.op_id)
+    & decode_hex(s + 53, 1, &flags);
+  if (!valid) {
+    return false;
+  }
+  // version 00 is exactly 55 characters and version ff is invalid.
+  if (length == kTraceparentLength ? version != 0 : (version == 0 || version == 0xff || s[kTraceparentLength] != '-')) {
+    return false;
+  }
+  if (is_zero(omd.ids.task_id, OBOE_TASK_ID_TRACEPARENT_LEN) || is_zero(omd.ids.op_id, OBOE_MAX_OP_ID_LEN)) {
+    return false;
+  }
+  omd.version = XTR_CURRENT_VERSION;
+  omd.task_len = OBOE_TASK_ID_TRACEPARENT_LEN;
+  omd.op_len = OBOE_MAX_OP_ID_LEN;
+  omd.flags = flags;
+  return true;
+}
+
+//
+// format a traceparent into out, which must have room for kTraceparentLength
+// characters. returns the number written.
+//
+size_t encodeTraceparent(const oboe_metadata_t& omd, char* out) {
+  char* b = out;
+  *b++ = '0';
+  *b++ = '0';
+  *b++ = '-';
+  b = encode_hex(omd.ids.task_id, OBOE_TASK_ID_TRACEPARENT_LEN, b);
+  *b++ = '-';
+  b = encode_hex(omd.ids.op_id, OBOE_MAX_OP_ID_LEN, b);
+  *b++ = '-';
+  b = encode_hex(&omd.flags, 1, b);
+  return b - out;
+}
+
+static bool is_ows(char c) {
+  return c == ' ' || c == '\t';
+}
+
+//
+// call fn(member, length) for each non-empty list member of a tracestate
+// with the optional whitespace around it removed. stops if fn returns false.
+//
+template <typename F>
+static void each_member(const char* s, size_t length, F fn) {
+  const char* end = s + length;
+  while (s < end) {
+    const char* comma = static_cast<const char*>(memchr(s, ',', end - s));
+    const char* next = comma ? comma : end;
+    const char* e = next;
+    while (s < e && is_ows(*s)) s++;
+    while (e > s && is_ows(e[-1])) e--;
+    if (e > s && !fn(s, static_cast<size_t>(e - s))) {
+      return;
+    }
+    s = next + 1;
+  }
+}
+
+static bool is_sw_member(const char* member, size_t length) {
+  return length >= 3 && member[0] == 's' && member[1] == 'w' && member[2] == '=';
+}
+
+//
+// find the value of the sw member of a tracestate. returns false if there
+// isn't one.
+//
+bool findSwMember(const char* s, size_t length, const char*& value, size_t& value_length) {
+  bool found = false;
+  each_member(s, length, [&](const char* member, size_t n) {
+    if (is_sw_member(member, n)) {
+      value = member + 3;
+      value_length = n - 3;
+      found = true;
+      return false;
+    }
+    return true;
+  });
+  return found;
+}
+
+//
+// the most an outgoing tracestate can need for an incoming one.
+//
+static size_t max_tracestate_length(size_t incoming_length) {
+  return kSwMemberLength + 1 + incoming_length;
+}
+
+//
+// format an outgoing tracestate: the sw member for the metadata, followed
+// by the incoming members other than sw. returns the number of characters
+// written to out, which must have room for max_tracestate_length().
+//
+static size_t encode_tracestate(const oboe_metadata_t& omd, const char* incoming,
+                                size_t incoming_length, char* out) {
+  char* b = out;
+  memcpy(b, "sw=", 3);
+  b += 3;
+  b = encode_hex(omd.ids.op_id, OBOE_MAX_OP_ID_LEN, b);
+  *b++ = '-';
+  b = encode_hex(&omd.flags, 1, b);
+
+  int members = 1;
+  each_member(incoming, incoming_length, [&](const char* member, size_t n) {
+    if (members >= kMaxTracestateMembers) {
+      return false;
+    }
+    if (!is_sw_member(member, n)) {
+      *b++ = ',';
+      memcpy(b, member, n);
+      b += n;
+      members += 1;
+    }
+    return true;
+  });
+
+  return b - out;
+}
+
+} // end namespace TraceContext
+
+using namespace TraceContext;
+
+//
+// Event.parseTraceContext(traceparent, tracestate)
+//
+// the headers may be strings, Buffers or Uint8Arrays.
+//
+// returns {event, sw}. event is an Event with the traceparent's metadata or
+// null if the traceparent isn't valid. sw is the value of the tracestate's
+// sw member, suitable for getTraceSettings(), or null if there isn't one.
+//
+Napi::Value Event::parseTraceContext(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  Napi::Object o = Napi::Object::New(env);
+  std::string storage;
+  const char* s;
+  size_t length;
+
+  Napi::Value event = env.Null();
+  oboe_metadata_t omd;
+  // future versions may append fields so only version 00 is limited to 55.
+  if (info.Length() >= 1 && get_header(info[0], storage, s, length)
+      && decodeTraceparent(s, length, omd)) {
+    event = Event::makeFromOboeMetadata(env, omd);
+  }
+  o.Set("event", event);
+
+  Napi::Value sw = env.Null();
+  const char* value;
+  size_t value_length;
+  if (info.Length() >= 2 && get_header(info[1], storage, s, length)
+      && findSwMember(s, length, value, value_length)) {
+    sw = Napi::String::New(env, value, value_length);
+  }
+  o.Set("sw", sw);
+
+  return o;
+}
+
+//
+// event.toTraceparent() - the event's traceparent header value.
+//
+Napi::Value Event::toTraceparent(const Napi::CallbackInfo& info) {
+  char buf[kTraceparentLength];
+  size_t n = encodeTraceparent(this->event.metadata, buf);
+  return Napi::String::New(info.Env(), buf, n);
+}
+
+//
+// event.toTracestate(incoming) - the event's tracestate header value. the
+// optional incoming tracestate's members, other than sw, follow the event's
+// sw member.
+//
+Napi::Value Event::toTracestate(const Napi::CallbackInfo& info) {
+  std::string storage;
+  const char* s = "";
+  size_t length = 0;
+  if (info.Length() >= 1) {
+    get_header(info[0], storage, s, length);
+  }
+
+  char small[256];
+  std::string large;
+  char* buf = small;
+  if (max_tracestate_length(length) > sizeof(small)) {
+    large.resize(max_tracestate_length(length));
+    buf = &large[0];
+  }
+  size_t n = encode_tracestate(this->event.metadata, s, length, buf);
+  return Napi::String::New(info.Env(), buf, n);
+}
+
+//
+// get the buffer and offset arguments of the write functions. returns false
+// if an exception was thrown.
+//
+static bool get_output(const Napi::CallbackInfo& info, const char* fn, uint8_t*& out, size_t& available) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsTypedArray()
+      || info[0].As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array) {
+    Napi::TypeError::New(env, std::string(fn) + "() - buffer must be a Buffer or Uint8Array").ThrowAsJavaScriptException();
+    return false;
+  }
+  Napi::Uint8Array buffer = info[0].As<Napi::Uint8Array>();
+  int64_t offset = 0;
+  if (info.Length() >= 2 && info[1].IsNumber()) {
+    offset = info[1].As<Napi::Number>().Int64Value();
+  }
+  if (offset < 0 || static_cast<size_t>(offset) > buffer.ElementLength()) {
+    Napi::RangeError::New(env, std::string(fn) + "() - offset is out of range").ThrowAsJavaScriptException();
+    return false;
+  }
+  out = buffer.Data() + offset;
+  available = buffer.ElementLength() - offset;
+  return true;
+}
+
+//
+// event.writeTraceparent(buffer, offset) writes the traceparent header value
+// into the buffer at offset. returns the number of bytes written or -1 if
+// it doesn't fit.
+//
+Napi::Value Event::writeTraceparent(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint8_t* out;
+  size_t available;
+  if (!get_output(info, "writeTraceparent", out, available)) {
+    return env.Null();
+  }
+  if (available < kTraceparentLength) {
+    return Napi::Number::New(env, -1);
+  }
+  size_t n = encodeTraceparent(this->event.metadata, reinterpret_cast<char*>(out));
+  return Napi::Number::New(env, n);
+}
+
+//
+// event.writeTracestate(buffer, offset, incoming) writes the tracestate
+// header value, as toTracestate(incoming) returns it, into the buffer at
+// offset. returns the number of bytes written or -1 if it doesn't fit.
+//
+Napi::Value Event::writeTracestate(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint8_t* out;
+  size_t available;
+  if (!get_output(info, "writeTracestate", out, available)) {
+    return env.Null();
+  }
+
+  std::string storage;
+  const char* s = "";
+  size_t length = 0;
+  if (info.Length() >= 3) {
+    get_header(info[2], storage, s, length);
+  }
+
+  if (available >= max_tracestate_length(length)) {
+    size_t n = encode_tracestate(this->event.metadata, s, length, reinterpret_cast<char*>(out));
+    return Napi::Number::New(env, n);
+  }
+
+  // it might still fit once any sw member is dropped so format it
+  // separately.
+  std::string buf(max_tracestate_length(length), '\0');
+  size_t n = encode_tracestate(this->event.metadata, s, length, &buf[0]);
+  if (n > available) {
+    return Napi::Number::New(env, -1);
+  }
+  memcpy(out, buf.data(), n);
+  return Napi::Number::New(env, n);
+}
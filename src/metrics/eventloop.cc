@@ -1,7 +1,6 @@
 #include <uv.h>
-#include <map>
 
-#include "hdr_histogram.h"
+#include "histogram.h"
 #include "eventloop.h"
 
 namespace ao { namespace metrics { namespace eventloop {
@@ -17,9 +16,6 @@ uint64_t prepare_time;
 uint64_t poll_timeout;
 
 struct hdr_histogram* hist;
-std::map<std::string, double> PERCENTILES = {
-  {"p50", 50.0}, {"p75", 75.0}, {"p90", 90.0}, {"p95", 95.0}, {"p99", 99.0}
-};
 
 //
 // the check callback, after i/o polling
@@ -93,40 +89,23 @@ bool stop() {
   return true;
 }
 
-bool getInterval(Napi::Object& obj) {
+//
+// read the interval's event loop latencies in microseconds.
+//
+bool readInterval(HistogramValues& values) {
   if (!enabled) {
     return false;
   }
-  // add each configured percentile
-  std::map<std::string, double>::iterator it;
-  for (it = PERCENTILES.begin(); it != PERCENTILES.end(); it++) {
-    const int64_t p = hdr_value_at_percentile(hist, it->second);
-    obj.Set(it->first, Napi::Number::New(obj.Env(), p));
-  }
+  read_histogram(hist, values);
+  return true;
+}
 
-  // the next two values are NaN if no eventloops executed so default them to 0.
-  // It's cheating a little bit by looking into hists code but min is set to
-  // INT64_MAX during histogram initialization.
-  double mean = 0;
-  double stddev = 0;
-  int64_t max = 0;
-
-  int64_t min = hdr_min(hist);
-
-  // this checks to see if this histogram is empty.
-  if (min < INT64_MAX) {
-    max = hdr_max(hist);
-    mean = hdr_mean(hist);
-    stddev = hdr_stddev(hist);
-    // reset the histogram if it received any data.
-    hdr_reset(hist);
+bool getInterval(Napi::Object& obj) {
+  HistogramValues values;
+  if (!readInterval(values)) {
+    return false;
   }
-
-  obj.Set("min", Napi::Number::New(obj.Env(), min));
-  obj.Set("max", Napi::Number::New(obj.Env(), max));
-  obj.Set("mean", Napi::Number::New(obj.Env(), mean));
-  obj.Set("stddev", Napi::Number::New(obj.Env(), stddev));
-
+  set_histogram_values(values, obj);
   return true;
 }
 
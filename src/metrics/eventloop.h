@@ -1,9 +1,11 @@
 #pragma once
 
 #include <napi.h>
+#include "histogram.h"
 
 namespace ao { namespace metrics { namespace eventloop {
   bool start();
   bool stop();
+  bool readInterval(HistogramValues&);
   bool getInterval(Napi::Object&);
 }}}
@@ -0,0 +1,320 @@
+#include <uv.h>
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <vector>
+
+#include <oboe/oboe.h>
+#include "gc.h"
+#include "eventloop.h"
+#include "process.h"
+#include "exporter.h"
+
+//
+// periodically submit the gc, eventloop and process interval data to oboe
+// as custom metrics. everything is done natively on a uv timer so there are
+// no JavaScript allocations.
+//
+// the exporter reads the same intervals as getMetrics() so only one of the
+// two should be used.
+//
+namespace ao { namespace metrics { namespace exporter {
+
+//
+// every metric the exporter can submit. the default name is the prefix
+// followed by the suffix.
+//
+enum MetricId {
+  kGcCount,
+  kGcTime,
+  kGcMajorCount,
+  kGcMajorP50 = kGcMajorCount + 1,
+  kGcMajorMax = kGcMajorP50 + kPercentileCount,
+  kGcMajorMean,
+  kGcMinorCount,
+  kGcMinorP50 = kGcMinorCount + 1,
+  kGcMinorMax = kGcMinorP50 + kPercentileCount,
+  kGcMinorMean,
+  kEventloopP50,
+  kEventloopMax = kEventloopP50 + kPercentileCount,
+  kEventloopMean,
+  kCpuUser,
+  kCpuSystem,
+  kMetricCount
+};
+
+static std::string suffixes[kMetricCount];
+
+struct Metric {
+  std::string name;
+  bool enabled;
+};
+
+static bool running = false;
+static uv_timer_t timer;
+static bool timer_initialized = false;
+
+// since the exporter was last started.
+static uint64_t ticks = 0;
+static uint64_t submitted = 0;
+static uint64_t failed = 0;
+
+static Metric metrics[kMetricCount];
+static bool host_tag = false;
+static std::string service;
+static std::vector<std::string> tag_strings;
+static std::vector<oboe_metric_tag_t> tags;
+
+static void init_suffixes() {
+  if (!suffixes[0].empty()) {
+    return;
+  }
+  suffixes[kGcCount] = ".gc.count";
+  suffixes[kGcTime] = ".gc.time";
+  suffixes[kGcMajorCount] = ".gc.major.count";
+  suffixes[kGcMajorMax] = ".gc.major.max";
+  suffixes[kGcMajorMean] = ".gc.major.mean";
+  suffixes[kGcMinorCount] = ".gc.minor.count";
+  suffixes[kGcMinorMax] = ".gc.minor.max";
+  suffixes[kGcMinorMean] = ".gc.minor.mean";
+  suffixes[kEventloopMax] = ".eventloop.max";
+  suffixes[kEventloopMean] = ".eventloop.mean";
+  suffixes[kCpuUser] = ".process.cpu.user";
+  suffixes[kCpuSystem] = ".process.cpu.system";
+  for (int i = 0; i < kPercentileCount; i++) {
+    std::string p = std::string(".") + PERCENTILES[i].name;
+    suffixes[kGcMajorP50 + i] = ".gc.major" + p;
+    suffixes[kGcMinorP50 + i] = ".gc.minor" + p;
+    suffixes[kEventloopP50 + i] = ".eventloop" + p;
+  }
+}
+
+static void summary(int id, double value) {
+  if (!metrics[id].enabled) {
+    return;
+  }
+  int status = oboe_custom_metric_summary(metrics[id].name.c_str(), value, 1, host_tag, service.c_str(),
+                                          tags.data(), tags.size());
+  // oboe returns 0 for success else a status code.
+  if (status == OBOE_CUSTOM_METRICS_OK) {
+    submitted += 1;
+  } else {
+    failed += 1;
+  }
+}
+
+static void increment(int id, int64_t count) {
+  if (!metrics[id].enabled || count == 0) {
+    return;
+  }
+  // oboe takes an int; saturate rather than wrap a huge count.
+  int n = static_cast<int>(std::min<int64_t>(std::max<int64_t>(count, INT_MIN), INT_MAX));
+  int status = oboe_custom_metric_increment(metrics[id].name.c_str(), n, host_tag, service.c_str(),
+                                            tags.data(), tags.size());
+  if (status == OBOE_CUSTOM_METRICS_OK) {
+    submitted += 1;
+  } else {
+    failed += 1;
+  }
+}
+
+//
+// submit a histogram's values unless nothing was recorded.
+//
+static void histogram(int p50, int max, int mean, const HistogramValues& values) {
+  if (values.empty) {
+    return;
+  }
+  for (int i = 0; i < kPercentileCount; i++) {
+    summary(p50 + i, values.percentiles[i]);
+  }
+  summary(max, values.max);
+  summary(mean, values.mean);
+}
+
+static void export_cb(uv_timer_t* handle) {
+  ticks += 1;
+
+  gc::Interval gc;
+  if (gc::readInterval(gc)) {
+    increment(kGcCount, gc.count);
+    if (gc.count) {
+      summary(kGcTime, gc.time);
+    }
+    increment(kGcMajorCount, gc.majorCount);
+    histogram(kGcMajorP50, kGcMajorMax, kGcMajorMean, gc.major);
+    increment(kGcMinorCount, gc.minorCount);
+    histogram(kGcMinorP50, kGcMinorMax, kGcMinorMean, gc.minor);
+  }
+
+  HistogramValues eventloop;
+  if (eventloop::readInterval(eventloop)) {
+    histogram(kEventloopP50, kEventloopMax, kEventloopMean, eventloop);
+  }
+
+  uint64_t user;
+  uint64_t system;
+  if (process::readInterval(user, system)) {
+    summary(kCpuUser, user);
+    summary(kCpuSystem, system);
+  }
+}
+
+//
+// JavaScript callable
+//
+// startExporter(options) starts collecting, if not already started, and
+// submits the data to oboe at each interval. returns true if the exporter
+// was started, false if it was already running.
+//
+// options.interval - seconds between submissions (default 60)
+// options.prefix - prefix of the metric names (default "trace.node")
+// options.names - {suffix: name} to rename metrics, e.g. {".gc.count": "gc"},
+//                 or {suffix: false} to not submit them.
+// options.tags - {tag: value} pairs sent with every metric
+// options.addHostTag - add the host tag (default false)
+// options.service - service name (default none)
+//
+// all durations are submitted in microseconds.
+//
+Napi::Value startExporter(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (running) {
+    return Napi::Boolean::New(env, false);
+  }
+
+  Napi::Object o = Napi::Object::New(env);
+  if (info.Length() >= 1 && info[0].IsObject()) {
+    o = info[0].ToObject();
+  } else if (info.Length() >= 1 && !info[0].IsUndefined()) {
+    Napi::TypeError::New(env, "startExporter() options must be an object").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  int64_t interval = 60;
+  Napi::Value v = o.Get("interval");
+  if (v.IsNumber()) {
+    interval = v.As<Napi::Number>().Int64Value();
+  }
+  if (interval < 1) {
+    Napi::RangeError::New(env, "startExporter() interval must be at least 1").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  std::string prefix = "trace.node";
+  v = o.Get("prefix");
+  if (v.IsString()) {
+    prefix = v.As<Napi::String>();
+  }
+
+  init_suffixes();
+  Napi::Object names = Napi::Object::New(env);
+  v = o.Get("names");
+  if (v.IsObject()) {
+    names = v.ToObject();
+  }
+  for (int i = 0; i < kMetricCount; i++) {
+    metrics[i].name = prefix + suffixes[i];
+    metrics[i].enabled = true;
+    if (names.Has(suffixes[i])) {
+      Napi::Value name = names.Get(suffixes[i]);
+      if (name.IsString()) {
+        metrics[i].name = name.As<Napi::String>();
+      } else {
+        metrics[i].enabled = name.ToBoolean();
+      }
+    }
+  }
+
+  host_tag = o.Get("addHostTag").ToBoolean();
+  v = o.Get("service");
+  service = v.IsString() ? v.As<Napi::String>().Utf8Value() : "";
+
+  // the tag strings are kept for the life of the exporter.
+  tag_strings.clear();
+  tags.clear();
+  v = o.Get("tags");
+  if (v.IsObject() && !v.IsArray()) {
+    Napi::Object t = v.ToObject();
+    Napi::Array keys = t.GetPropertyNames();
+    for (uint32_t i = 0; i < keys.Length(); i++) {
+      Napi::Value key = keys[i];
+      // a getter or toString() may throw.
+      Napi::String name = key.ToString();
+      if (env.IsExceptionPending()) {
+        return env.Undefined();
+      }
+      Napi::Value value = t.Get(key);
+      if (env.IsExceptionPending()) {
+        return env.Undefined();
+      }
+      Napi::String string = value.ToString();
+      if (env.IsExceptionPending()) {
+        return env.Undefined();
+      }
+      tag_strings.push_back(name);
+      tag_strings.push_back(string);
+    }
+    for (size_t i = 0; i < tag_strings.size(); i += 2) {
+      oboe_metric_tag_t tag;
+      tag.key = (char*)tag_strings[i].c_str();
+      tag.value = (char*)tag_strings[i + 1].c_str();
+      tags.push_back(tag);
+    }
+  }
+
+  // each returns false if it was already started.
+  gc::start();
+  eventloop::start();
+  process::start();
+
+  if (!timer_initialized) {
+    uv_timer_init(uv_default_loop(), &timer);
+    // don't keep the process alive just to export metrics.
+    uv_unref(reinterpret_cast<uv_handle_t*>(&timer));
+    timer_initialized = true;
+  }
+  uint64_t interval_ms = interval * 1000;
+  uv_timer_start(&timer, export_cb, interval_ms, interval_ms);
+  running = true;
+  ticks = 0;
+  submitted = 0;
+  failed = 0;
+
+  return Napi::Boolean::New(env, true);
+}
+
+//
+// JavaScript callable
+//
+// stopExporter() stops submitting metrics. collection continues until
+// stop() is called. returns false if the exporter wasn't running.
+//
+Napi::Value stopExporter(const Napi::CallbackInfo& info) {
+  bool was_running = running;
+  if (running) {
+    uv_timer_stop(&timer);
+    running = false;
+  }
+  return Napi::Boolean::New(info.Env(), was_running);
+}
+
+//
+// JavaScript callable
+//
+// getExporterStats() returns {running, ticks, submitted, failed}. ticks is
+// the number of intervals, submitted the number of metrics oboe accepted and
+// failed the number it rejected since the exporter was last started.
+//
+Napi::Value getExporterStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("running", Napi::Boolean::New(env, running));
+  o.Set("ticks", Napi::Number::New(env, ticks));
+  o.Set("submitted", Napi::Number::New(env, submitted));
+  o.Set("failed", Napi::Number::New(env, failed));
+  return o;
+}
+
+}}} // namespace ao::metrics::exporter
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <napi.h>
+
+namespace ao { namespace metrics { namespace exporter {
+  Napi::Value startExporter(const Napi::CallbackInfo&);
+  Napi::Value stopExporter(const Napi::CallbackInfo&);
+  Napi::Value getExporterStats(const Napi::CallbackInfo&);
+}}}
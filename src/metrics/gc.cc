@@ -1,7 +1,6 @@
 #include <nan.h>
-#include <map>
 
-#include "hdr_histogram.h"
+#include "histogram.h"
 #include "gc.h"
 
 /* https://v8docs.nodesource.com/node-8.16/d4/da0/v8_8h_source.html#l06365
@@ -28,8 +27,6 @@
 namespace ao { namespace metrics { namespace gc {
 using namespace v8;
 
-void set_histogram_values(hdr_histogram*, Napi::Object&);
-
 typedef struct GCData {
 	uint64_t gcTime;
   uint64_t gcCount;
@@ -44,10 +41,6 @@ GCData_t raw;
 GCData_t interval_base;
 GCData_t interval;
 
-std::map<std::string, double> PERCENTILES = {
-  {"p50", 50.0}, {"p75", 75.0}, {"p90", 90.0}, {"p95", 95.0}, {"p99", 99.0}
-};
-
 bool enabled = false;
 
 uint64_t gcStartTime;
@@ -136,32 +129,22 @@ bool stop () {
   return status;
 }
 
-bool getInterval(Napi::Object& obj) {
+//
+// read the interval's collections. times are in microseconds.
+//
+bool readInterval(Interval& i) {
 
   if (!enabled) {
     return false;
   }
 
-  uint64_t count = raw.gcCount - interval_base.gcCount;
-  obj.Set("gcCout", Napi::Number::New(obj.Env(), count));
-
-  uint64_t time = raw.gcTime - interval_base.gcTime;
-  obj.Set("gcTime", Napi::Number::New(obj.Env(), time));
-
-  uint64_t majorCount = raw.majorCount - interval_base.majorCount;
-  uint64_t minorCount = raw.minorCount - interval_base.minorCount;
-
-  auto major = Napi::Object::New(obj.Env());
-  auto minor = Napi::Object::New(obj.Env());
-
-  set_histogram_values(h_major, major);
-  set_histogram_values(h_minor, minor);
-
-  obj.Set("major", major);
-  obj.Set("minor", minor);
+  i.count = raw.gcCount - interval_base.gcCount;
+  i.time = raw.gcTime - interval_base.gcTime;
+  i.majorCount = raw.majorCount - interval_base.majorCount;
+  i.minorCount = raw.minorCount - interval_base.minorCount;
 
-  major.Set("count", Napi::Number::New(major.Env(), majorCount));
-  minor.Set("count", Napi::Number::New(minor.Env(), minorCount));
+  read_histogram(h_major, i.major);
+  read_histogram(h_minor, i.minor);
 
   // reset the interval base values
   interval_base.gcCount = raw.gcCount;
@@ -176,35 +159,28 @@ bool getInterval(Napi::Object& obj) {
   return true;
 }
 
-void set_histogram_values(hdr_histogram* h, Napi::Object& obj) {
-  std::map<std::string, double>::iterator it;
-  for (it = PERCENTILES.begin(); it != PERCENTILES.end(); it++) {
-    const int64_t p = hdr_value_at_percentile(h, it->second);
-    obj.Set(it->first, Napi::Number::New(obj.Env(), p));
+bool getInterval(Napi::Object& obj) {
+  Interval i;
+  if (!readInterval(i)) {
+    return false;
   }
 
-  // the next two values are NaN if no GCs executed so default them to 0.
-  // It's cheating a little bit by looking into hists code but min is set to
-  // INT64_MAX during histogram initialization.
-  double mean = 0;
-  double stddev = 0;
-  int64_t max = 0;
-
-  int64_t min = hdr_min(h);
-
-  // this checks to see if the histogram is empty.
-  if (min < INT64_MAX) {
-    max = hdr_max(h);
-    mean = hdr_mean(h);
-    stddev = hdr_stddev(h);
-    // reset the histogram if it received any data.
-    hdr_reset(h);
-  }
+  obj.Set("gcCout", Napi::Number::New(obj.Env(), i.count));
+  obj.Set("gcTime", Napi::Number::New(obj.Env(), i.time));
+
+  auto major = Napi::Object::New(obj.Env());
+  auto minor = Napi::Object::New(obj.Env());
 
-  obj.Set("min", Napi::Number::New(obj.Env(), min));
-  obj.Set("max", Napi::Number::New(obj.Env(), max));
-  obj.Set("mean", Napi::Number::New(obj.Env(), mean));
-  obj.Set("stddev", Napi::Number::New(obj.Env(), stddev));
+  set_histogram_values(i.major, major);
+  set_histogram_values(i.minor, minor);
+
+  obj.Set("major", major);
+  obj.Set("minor", minor);
+
+  major.Set("count", Napi::Number::New(major.Env(), i.majorCount));
+  minor.Set("count", Napi::Number::New(minor.Env(), i.minorCount));
+
+  return true;
 }
 
 }}} // namespace ao::metrics::gc
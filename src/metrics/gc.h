@@ -1,9 +1,20 @@
 #pragma once
 
 #include <napi.h>
+#include "histogram.h"
 
 namespace ao { namespace metrics { namespace gc {
+  struct Interval {
+    uint64_t count;
+    uint64_t time;
+    uint64_t majorCount;
+    uint64_t minorCount;
+    HistogramValues major;
+    HistogramValues minor;
+  };
+
   bool start();
   bool stop();
+  bool readInterval(Interval&);
   bool getInterval(Napi::Object&);
 }}}
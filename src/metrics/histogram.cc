@@ -0,0 +1,48 @@
+#include "histogram.h"
+
+namespace ao { namespace metrics {
+
+const Percentile PERCENTILES[kPercentileCount] = {
+  {"p50", 50.0}, {"p75", 75.0}, {"p90", 90.0}, {"p95", 95.0}, {"p99", 99.0}
+};
+
+//
+// read a histogram's values and reset it if it received any data.
+//
+void read_histogram(hdr_histogram* h, HistogramValues& values) {
+  for (int i = 0; i < kPercentileCount; i++) {
+    values.percentiles[i] = hdr_value_at_percentile(h, PERCENTILES[i].percentile);
+  }
+
+  // the next two values are NaN if nothing was recorded so default them to 0.
+  // It's cheating a little bit by looking into hists code but min is set to
+  // INT64_MAX during histogram initialization.
+  values.mean = 0;
+  values.stddev = 0;
+  values.max = 0;
+
+  values.min = hdr_min(h);
+
+  // this checks to see if the histogram is empty.
+  values.empty = values.min == INT64_MAX;
+  if (!values.empty) {
+    values.max = hdr_max(h);
+    values.mean = hdr_mean(h);
+    values.stddev = hdr_stddev(h);
+    // reset the histogram if it received any data.
+    hdr_reset(h);
+  }
+}
+
+void set_histogram_values(const HistogramValues& values, Napi::Object& obj) {
+  for (int i = 0; i < kPercentileCount; i++) {
+    obj.Set(PERCENTILES[i].name, Napi::Number::New(obj.Env(), values.percentiles[i]));
+  }
+
+  obj.Set("min", Napi::Number::New(obj.Env(), values.min));
+  obj.Set("max", Napi::Number::New(obj.Env(), values.max));
+  obj.Set("mean", Napi::Number::New(obj.Env(), values.mean));
+  obj.Set("stddev", Napi::Number::New(obj.Env(), values.stddev));
+}
+
+}} // namespace ao::metrics
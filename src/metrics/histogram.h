@@ -0,0 +1,32 @@
+#pragma once
+
+#include <napi.h>
+#include "hdr_histogram.h"
+
+namespace ao { namespace metrics {
+
+struct Percentile {
+  const char* name;
+  double percentile;
+};
+
+const int kPercentileCount = 5;
+extern const Percentile PERCENTILES[kPercentileCount];
+
+//
+// the values of a histogram for an interval.
+//
+struct HistogramValues {
+  int64_t percentiles[kPercentileCount];
+  int64_t min;
+  int64_t max;
+  double mean;
+  double stddev;
+  // true if nothing was recorded in the interval
+  bool empty;
+};
+
+void read_histogram(hdr_histogram*, HistogramValues&);
+void set_histogram_values(const HistogramValues&, Napi::Object&);
+
+}} // namespace ao::metrics
@@ -2,6 +2,7 @@
 #include "gc.h"
 #include "eventloop.h"
 #include "process.h"
+#include "exporter.h"
 
 namespace ao { namespace metrics {
 
@@ -48,6 +49,9 @@ namespace ao { namespace metrics {
     exports.Set("start", Napi::Function::New(env, start));
     exports.Set("stop", Napi::Function::New(env, stop));
     exports.Set("getMetrics", Napi::Function::New(env, getMetrics));
+    exports.Set("startExporter", Napi::Function::New(env, exporter::startExporter));
+    exports.Set("stopExporter", Napi::Function::New(env, exporter::stopExporter));
+    exports.Set("getExporterStats", Napi::Function::New(env, exporter::getExporterStats));
 
     return exports;
   }
@@ -25,9 +25,9 @@ int64_t usec_time (uv_timeval_t t) {
 }
 
 //
-// get interval data
+// read the interval's user and system cpu time in microseconds.
 //
-bool getInterval(Napi::Object& obj) {
+bool readInterval(uint64_t& user_time, uint64_t& sys_time) {
   if (!enabled) {
     return false;
   }
@@ -35,14 +35,27 @@ bool getInterval(Napi::Object& obj) {
   uv_rusage_t rusage;
   uv_getrusage(&rusage);
 
-  const uint64_t user_time = usec_time(rusage.ru_utime) - usec_time(prev_rusage.ru_utime);
-  const uint64_t sys_time = usec_time(rusage.ru_stime) - usec_time(prev_rusage.ru_stime);
+  user_time = usec_time(rusage.ru_utime) - usec_time(prev_rusage.ru_utime);
+  sys_time = usec_time(rusage.ru_stime) - usec_time(prev_rusage.ru_stime);
+
+  prev_rusage = rusage;
+
+  return true;
+}
+
+//
+// get interval data
+//
+bool getInterval(Napi::Object& obj) {
+  uint64_t user_time;
+  uint64_t sys_time;
+  if (!readInterval(user_time, sys_time)) {
+    return false;
+  }
 
   obj.Set("user", Napi::Number::New(obj.Env(), user_time));
   obj.Set("system", Napi::Number::New(obj.Env(), sys_time));
 
-  prev_rusage = rusage;
-
   return true;
 }
 
@@ -5,5 +5,6 @@
 namespace ao { namespace metrics { namespace process {
   bool start();
   bool stop();
+  bool readInterval(uint64_t&, uint64_t&);
   bool getInterval(Napi::Object&);
 }}}
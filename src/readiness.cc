@@ -0,0 +1,204 @@
+#include "bindings.h"
+#include "uv.h"
+#include <atomic>
+
+//
+// Asynchronous readiness checks.
+//
+// oboe_is_ready() blocks for up to the time it's given to wait, which can
+// hold up the event loop at startup. isReadyToSampleAsync() does the wait
+// on a libuv threadpool thread and resolves a promise with the status.
+//
+// onReadyToSampleChange() watches for later changes, e.g., the collector
+// becoming unreachable, by polling oboe_is_ready() without waiting on an
+// unref'd timer.
+//
+
+namespace Readiness {
+
+class ReadyWorker : public Napi::AsyncWorker {
+ public:
+  ReadyWorker(Napi::Env env, int ms)
+    : Napi::AsyncWorker(env, "isReadyToSampleAsync"),
+      deferred(Napi::Promise::Deferred::New(env)),
+      ms(ms) {}
+
+  Napi::Promise Promise() {
+    return deferred.Promise();
+  }
+
+  // runs on a libuv threadpool thread.
+  void Execute() override {
+    status = oboe_is_ready(ms);
+  }
+
+  void OnOK() override {
+    deferred.Resolve(Napi::Number::New(Env(), status));
+  }
+
+  void OnError(const Napi::Error& e) override {
+    deferred.Reject(e.Value());
+  }
+
+ private:
+  Napi::Promise::Deferred deferred;
+  int ms;
+  int status = 0;
+};
+
+//
+// JavaScript callable
+//
+// isReadyToSampleAsync(ms) returns a promise that resolves to the same
+// status codes as isReadyToSample(ms).
+//
+// the wait occupies a threadpool thread so long waits should not be
+// started in parallel.
+//
+Napi::Value isReadyToSampleAsync(const Napi::CallbackInfo& info) {
+  int ms = 0;  // milliseconds to wait
+  if (info.Length() >= 1 && info[0].IsNumber()) {
+    ms = info[0].As<Napi::Number>().Int64Value();
+  }
+  if (ms < 0) {
+    ms = 0;
+  }
+
+  ReadyWorker* worker = new ReadyWorker(info.Env(), ms);
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+
+  return promise;
+}
+
+// the environment that's watching, null if none. it's claimed by the first
+// environment to watch and released when that environment stops watching
+// or is torn down. everything below is only used on its thread.
+static std::atomic<napi_env> owner_env(nullptr);
+// allocated when watching starts and freed when it's closed.
+static uv_timer_t* timer = nullptr;
+static Napi::ThreadSafeFunction listener;
+static int last_status = 0;
+
+static void poll_cb(uv_timer_t* handle) {
+  int status = oboe_is_ready(0);
+  if (status == last_status) {
+    return;
+  }
+  int previous = last_status;
+  last_status = status;
+
+  // the listener is called on a later turn of the event loop with its own
+  // scope; an exception it throws is uncaught like any other callback's.
+  listener.NonBlockingCall([status, previous](Napi::Env env, Napi::Function fn) {
+    fn.Call({Napi::Number::New(env, status), Napi::Number::New(env, previous)});
+  });
+}
+
+static void stop_watching() {
+  if (!timer) {
+    return;
+  }
+  uv_timer_stop(timer);
+  uv_close(reinterpret_cast<uv_handle_t*>(timer), [](uv_handle_t* handle) {
+    delete reinterpret_cast<uv_timer_t*>(handle);
+  });
+  timer = nullptr;
+  listener.Release();
+}
+
+static void cleanup(void*) {
+  stop_watching();
+  owner_env.store(nullptr);
+}
+
+//
+// JavaScript callable
+//
+// onReadyToSampleChange(callback, options)
+//
+// callback(status, previous) is called when the status returned by
+// isReadyToSample(0) changes. calling with a null callback stops watching.
+// only one callback is kept; a new one replaces the previous one.
+//
+// options.interval - milliseconds between checks (default 1000)
+// options.previous - the status the first check is compared to (default the
+//                    current status). a caller that already knows a status
+//                    passes it so a change since then isn't missed.
+//
+// returns the current status. only one thread can watch at a time; another
+// can once it has stopped.
+//
+Napi::Value onReadyToSampleChange(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !(info[0].IsFunction() || info[0].IsNull())) {
+    Napi::TypeError::New(env, "onReadyToSampleChange() - callback must be a function or null").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  int64_t interval = 1000;
+  Napi::Value previous = env.Undefined();
+  if (info.Length() >= 2 && info[1].IsObject()) {
+    previous = info[1].ToObject().Get("previous");
+    if (!previous.IsNumber() && !previous.IsUndefined()) {
+      Napi::TypeError::New(env, "onReadyToSampleChange() - previous must be a number").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    Napi::Value v = info[1].ToObject().Get("interval");
+    if (v.IsNumber()) {
+      interval = v.As<Napi::Number>().Int64Value();
+    } else if (!v.IsUndefined()) {
+      Napi::TypeError::New(env, "onReadyToSampleChange() - interval must be a number").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    if (interval < 1) {
+      interval = 1;
+    }
+  }
+
+  napi_env expected = nullptr;
+  bool claimed = owner_env.compare_exchange_strong(expected, env);
+  if (!claimed && expected != env) {
+    Napi::Error::New(env, "onReadyToSampleChange() - already watching on another thread").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  stop_watching();
+  int status = oboe_is_ready(0);
+
+  if (info[0].IsNull()) {
+    // let another thread watch.
+    if (!claimed) {
+      napi_remove_env_cleanup_hook(env, cleanup, nullptr);
+    }
+    owner_env.store(nullptr);
+    return Napi::Number::New(env, status);
+  }
+  if (claimed) {
+    napi_add_env_cleanup_hook(env, cleanup, nullptr);
+  }
+
+  last_status = previous.IsNumber() ? previous.As<Napi::Number>().Int32Value() : status;
+  listener = Napi::ThreadSafeFunction::New(env, info[0].As<Napi::Function>(), "onReadyToSampleChange", 0, 1);
+  // don't keep the process alive just to watch.
+  listener.Unref(env);
+
+  uv_loop_t* loop;
+  napi_get_uv_event_loop(env, &loop);
+  timer = new uv_timer_t;
+  uv_timer_init(loop, timer);
+  uv_unref(reinterpret_cast<uv_handle_t*>(timer));
+  uv_timer_start(timer, poll_cb, interval, interval);
+
+  return Napi::Number::New(env, status);
+}
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
+  exports.Set("isReadyToSampleAsync", Napi::Function::New(env, isReadyToSampleAsync));
+  exports.Set("onReadyToSampleChange", Napi::Function::New(env, onReadyToSampleChange));
+
+  return exports;
+}
+
+} // end namespace Readiness
@@ -1,10 +1,9 @@
 #include "bindings.h"
+#include "reporter/reporter.h"
+#include <algorithm>
+#include <cstring>
 #include <vector>
 
-int64_t get_integer(Napi::Object, const char*, int64_t = 0);
-std::string* get_string(Napi::Object, const char*, const char* = "");
-bool get_boolean(Napi::Object obj, const char*, bool = false);
-
 int send_event_x(const Napi::CallbackInfo&, int);
 Napi::Value send_span(const Napi::CallbackInfo&, send_generic_span_t send_function);
 
@@ -35,7 +34,31 @@ Napi::Value send_span(const Napi::CallbackInfo& info, send_generic_span_t send_f
   Napi::Object obj = info[0].ToObject();
 
   oboe_span_params_t args;
+  SpanStrings strings;
+  get_span_params(obj, strings, args);
+
+  char final_txname[OBOE_TRANSACTION_NAME_MAX_LENGTH + 1];
+
+  int length = send_span_core(send_function, final_txname, sizeof(final_txname), &args,
+                              strings.trace_id.c_str());
+
+  // if an error return the code.
+  if (length < 0) {
+    return Napi::Number::New(env, length);
+  }
+
+  // return the transaction name used so it can be used by the agent.
+  return TxnameCache::get(env, final_txname);
+
+}
 
+//
+// fill in oboe's span params from a JavaScript span object. the string
+// fields of args point into strings so strings must not go out of scope
+// until oboe has been called. span.exemplar, a sampled Event or trace id,
+// is put in strings.trace_id.
+//
+void get_span_params(Napi::Object obj, SpanStrings& strings, oboe_span_params_t& args) {
   args.version = 1;
   // Number.MAX_SAFE_INTEGER is big enough for any reasonable transaction time.
   // max_safe_seconds = MAX_SAFE_INTEGER / 1000000 microseconds
@@ -45,60 +68,115 @@ Napi::Value send_span(const Napi::CallbackInfo& info, send_generic_span_t send_f
   args.has_error = get_boolean(obj, "error", false);
   args.status = get_integer(obj, "status");
 
-  // REMEMBER TO FREE ALL RETURNED STD::STRINGS AFTER PASSING
-  // THEM TO OBOE.
-  std::string* txname = get_string(obj, "txname");
-  args.transaction = txname->c_str();
+  strings.txname = get_string(obj, "txname");
+  args.transaction = strings.txname.c_str();
 
-  std::string* url = get_string(obj, "url");
-  args.url = url->c_str();
+  strings.url = get_string(obj, "url");
+  args.url = strings.url.c_str();
 
-  std::string* domain = get_string(obj, "domain");
-  args.domain = domain->c_str();
+  strings.domain = get_string(obj, "domain");
+  args.domain = strings.domain.c_str();
 
-  std::string* method = get_string(obj, "method");
-  args.method = method->c_str();
-
-  std::string* service = get_string(obj, "service");
-  args.service = service->c_str();
-
-  char final_txname[OBOE_TRANSACTION_NAME_MAX_LENGTH + 1];
+  strings.method = get_string(obj, "method");
+  args.method = strings.method.c_str();
 
-  int length = send_function(final_txname, sizeof(final_txname), &args);
+  strings.service = get_string(obj, "service");
+  args.service = strings.service.c_str();
 
-  // don't forget to FREE STRINGS CREATED by get_string().
-  delete txname;
-  delete url;
-  delete domain;
-  delete method;
-  delete service;
+  // span exemplars are only kept by the span histograms so don't look for
+  // one unless it will be used.
+  if (!Exemplars::enabled || !SpanHistograms::enabled
+      || !Exemplars::traceId(obj.Get("exemplar"), strings.trace_id)) {
+    strings.trace_id.clear();
+  }
+}
 
-  // if an error return the code.
-  if (length < 0) {
-    return Napi::Number::New(env, length);
+//
+// the single place where spans are handed to oboe. both the single span
+// and the batch functions end up here.
+//
+int send_span_core(send_generic_span_t send_function, char* final_txname, uint16_t size, oboe_span_params_t* args,
+                   const char* trace_id) {
+  // if there is no transaction name oboe derives one from the url. normalize
+  // it first, if configured, so oboe sees a bounded set of urls.
+  char normalized_url[OBOE_TRANSACTION_NAME_MAX_LENGTH + 1];
+  if (send_function == oboe_http_span && (!args->transaction || !*args->transaction)
+      && args->url && *args->url) {
+    if (TxnameNormalizer::normalize(args->url, normalized_url, sizeof(normalized_url))) {
+      args->url = normalized_url;
+    }
   }
 
-  // return the transaction name used so it can be used by the agent.
-  return Napi::String::New(env, final_txname);
+  int length = send_function(final_txname, size, args);
 
+  const char* txname = length < 0 ? nullptr : final_txname;
+  SpanHistograms::record(txname, args->duration, args->has_error, trace_id);
+  TopTransactions::record(txname, args->duration);
+
+  return length;
 }
 
 enum SMFlags {
   kSMFlagsTesting = 1 << 0,
-  kSMFlagsNoop = 1 << 1
+  kSMFlagsNoop = 1 << 1,
+  kSMFlagsCompactErrors = 1 << 2
+};
+
+//
+// sendMetrics() error codes. compact mode returns the codes; the messages
+// are only built when needed.
+//
+enum MetricError {
+  kMetricNotObject = 1,
+  kMetricDropped,
+  kMetricNoName,
+  kMetricCountNotNumber,
+  kMetricCountNotPositive,
+  kMetricValueNotNumber,
+  kMetricDistributionNoValue,
+  kMetricTagsNotObject,
+  kMetricTagConversion,
+  kMetricCardinality,
+  kMetricDistributionNegative,
+  kMetricDistributionSeries,
+  kMetricSendFailed,
+  kMetricErrorCount
+};
+
+static const char* metric_error_messages[kMetricErrorCount] = {
+  "",
+  "metric must be plain object",
+  "metric dropped: reporter queue full",
+  "must have string name",
+  "count must be a number",
+  "count must be greater than 0",
+  "summary value must be numeric",
+  "distribution requires a value",
+  "tags must be plain object",
+  "string conversion of value failed",
+  "metric rejected: cardinality limit exceeded",
+  "distribution value must not be negative",
+  "distribution series limit exceeded",
+  "metric send failed"
 };
+
 //
 // internal function used by sendMetric() (deprecated) and sendMetrics().
 //
 Napi::Value send_metrics_core (Napi::Env env, Napi::Array metrics, uint64_t flags) {
   int64_t goodCount = 0;
-  const char* service_name = "";
   bool testing = flags & kSMFlagsTesting;
   bool noop = flags & kSMFlagsNoop;
-
-  Napi::Array errors = Napi::Array::New(env);
+  bool compact = flags & kSMFlagsCompactErrors;
+
+  Napi::Array errors;
+  // compact mode keeps the index and code of each error.
+  std::vector<uint32_t> error_indexes;
+  std::vector<uint8_t> error_codes;
+  if (!compact) {
+    errors = Napi::Array::New(env);
+  }
   Napi::Array echo;
-  Napi::Object echoTags;
   if (testing) {
     echo = Napi::Array::New(env);
   }
@@ -109,6 +187,7 @@ Napi::Value send_metrics_core (Napi::Env env, Napi::Array metrics, uint64_t flag
   //
   for (size_t i = 0; i < metrics.Length(); i++) {
     bool is_summary = false;
+    bool is_distribution = false;
     std::string name;
     int64_t count;
     double value = 0;
@@ -116,24 +195,40 @@ Napi::Value send_metrics_core (Napi::Env env, Napi::Array metrics, uint64_t flag
 
     Napi::Value element = metrics[i];
 
-    // little lambda for errors.
-    auto set_error = [&](const char* code) {
+    // little lambda for errors. status is oboe's status if sending failed.
+    auto set_error = [&](MetricError code, int status = 0) {
+      if (compact) {
+        error_indexes.push_back(i);
+        error_codes.push_back(code);
+        return;
+      }
       Napi::Object err = Napi::Object::New(env);
-      err.Set("code", code);
+      if (code == kMetricSendFailed) {
+        std::string error_msg = "metric send failed: " + std::to_string(status);
+        err.Set("code", error_msg);
+      } else {
+        err.Set("code", metric_error_messages[code]);
+      }
       err.Set("metric", element);
       errors[errors.Length()] = err;
     };
 
     if (!element.IsObject() || element.IsArray()) {
-      set_error("metric must be plain object");
+      set_error(kMetricNotObject);
       continue;
     }
     Napi::Object metric = element.As<Napi::Object>();
 
+    // under critical back-pressure don't do any work for the metric.
+    if (!noop && Pressure::dropMetric()) {
+      set_error(kMetricDropped);
+      continue;
+    }
+
     // make sure there is a string name. valid characters if
     // choosing to add in the future: ‘A-Za-z0-9.:-_’.
     if (!metric.Has("name") || !metric.Get("name").IsString()) {
-      set_error("must have string name");
+      set_error(kMetricNoName);
       continue;
     }
     name = metric.Get("name").As<Napi::String>();
@@ -144,12 +239,12 @@ Napi::Value send_metrics_core (Napi::Env env, Napi::Array metrics, uint64_t flag
     } else {
       Napi::Value c = metric.Get("count");
       if (!c.IsNumber()) {
-        set_error("count must be a number");
+        set_error(kMetricCountNotNumber);
         continue;
       }
       count = c.As<Napi::Number>().DoubleValue();
       if (count <= 0) {
-        set_error("count must be greater than 0");
+        set_error(kMetricCountNotPositive);
         continue;
       }
     }
@@ -158,101 +253,117 @@ Napi::Value send_metrics_core (Napi::Env env, Napi::Array metrics, uint64_t flag
     if (metric.Has("value")) {
       Napi::Value v = metric.Get("value");
       if (!v.IsNumber()) {
-        set_error("summary value must be numeric");
+        set_error(kMetricValueNotNumber);
         continue;
       }
       is_summary = true;
       value = v.As<Napi::Number>().DoubleValue();
     }
 
+    // a distribution is a summary recorded in a native histogram.
+    if (metric.Has("distribution") && metric.Get("distribution").ToBoolean()) {
+      if (!is_summary) {
+        set_error(kMetricDistributionNoValue);
+        continue;
+      }
+      is_distribution = true;
+    }
+
     if (metric.Has("addHostTag")) {
       add_host_tag = metric.Get("addHostTag").ToBoolean();
     }
 
+    // an optional sampled Event or trace id linking the metric to a trace.
+    std::string trace_id;
+    bool has_exemplar = metric.Has("exemplar") && Exemplars::traceId(metric.Get("exemplar"), trace_id);
+
+    // an optional service name
+    std::string service = get_string(metric, "service");
+
     //
     // handle tags
     //
-    size_t tag_count = 0;
     Napi::Object tags;
-    Napi::Array keys;
-
     if (metric.Has("tags")) {
       Napi::Value v = metric.Get("tags");
       if (!v.IsObject() || v.IsArray()) {
-        set_error("tags must be plain object");
+        set_error(kMetricTagsNotObject);
         continue;
       }
       tags = v.As<Napi::Object>();
-      keys = tags.GetPropertyNames();
-      tag_count = keys.Length();
-
-      if (testing) {
-        echoTags = Napi::Object::New(env);
-      }
-    }
-
-    // allocate oboe's key-value pair structure
-    oboe_metric_tag_t otags[tag_count];
-
-    // save all the tag strings so they won't go out of scope
-    std::vector<std::string> holdKeys(tag_count);
-    std::vector<std::string> holdValues(tag_count);
-
-    bool had_error = false;
-    size_t n = 0;
-    while (n < tag_count) {
-      Napi::Value key = keys[n];
-      holdKeys[n] = key.ToString();
-
-      Napi::Value value = tags.Get(keys[n]);
-      holdValues[n] = value.ToString();
-      // i don't know how ToString() can fail but the doc says
-      // it can so let's try to handle it.
-      if (env.IsExceptionPending()) {
-        Napi::Error error = env.GetAndClearPendingException();
-        had_error = true;
-        break;
-      }
-
-      otags[n].key = (char*)holdKeys[n].c_str();
-      otags[n].value = (char*)holdValues[n].c_str();
-
-      if (testing) {
-        echoTags.Set(holdKeys[n], holdValues[n]);
-      }
-      n += 1;
     }
 
-    if (had_error) {
-      set_error("string conversion of value failed");
+    // the series holds the tag strings and oboe's key-value pair structure.
+    // a repeated series reuses them rather than converting the tags again.
+    SeriesCache::Series* series = SeriesCache::get(env, name, service, add_host_tag, tags);
+    if (!series) {
+      set_error(kMetricTagConversion);
       continue;
     }
+    size_t tag_count = series->keys.size();
+    const std::vector<std::string>* values = &series->values;
+    oboe_metric_tag_t* otags = series->otags.data();
+
+    // keep a bad tag value from creating an unbounded number of series.
+    std::vector<std::string> folded;
+    std::vector<oboe_metric_tag_t> folded_tags;
+    if (!noop) {
+      int guard = Cardinality::check(name, series->keys, series->values);
+      if (guard == Cardinality::kReject) {
+        set_error(kMetricCardinality);
+        continue;
+      } else if (guard == Cardinality::kFold) {
+        folded.assign(tag_count, Cardinality::kFoldedValue);
+        folded_tags = series->otags;
+        for (size_t n = 0; n < tag_count; n++) {
+          folded_tags[n].value = (char*)folded[n].c_str();
+        }
+        values = &folded;
+        otags = folded_tags.data();
+      }
+    }
 
     int status;
     if (noop) {
       status = 0;
+    } else if (is_distribution) {
+      status = Distributions::record(env, name, service, value, count, add_host_tag, series->keys, *values);
+      if (status == Distributions::kInvalidValue) {
+        set_error(kMetricDistributionNegative);
+        continue;
+      } else if (status == Distributions::kSeriesLimitExceeded) {
+        set_error(kMetricDistributionSeries);
+        continue;
+      }
+    } else if (SharedMetrics::record(name, service, series->keys, *values, add_host_tag,
+                                     is_summary, value, count)) {
+      status = 0;
     } else {
       if (is_summary) {
         status = oboe_custom_metric_summary(name.c_str(), value, count,
-                                            add_host_tag, service_name,
+                                            add_host_tag, service.c_str(),
                                             otags, tag_count);
       } else {
         status = oboe_custom_metric_increment(name.c_str(), count,
-                                              add_host_tag, service_name,
+                                              add_host_tag, service.c_str(),
                                               otags, tag_count);
       }
     }
 
     // oboe returns 0 for success else a status code;
     if (status != 0) {
-      std::string error_msg = "metric send failed: " + std::to_string(status);
-      set_error(error_msg.c_str());
+      set_error(kMetricSendFailed, status);
       continue;
     }
 
     // everything is set at this point
     goodCount += 1;
 
+    if (has_exemplar && !noop) {
+      Exemplars::offerMetric(name, service, series->keys, *values, add_host_tag,
+                             is_summary ? value : count, trace_id);
+    }
+
     // if testing also return metrics that were sent.
     if (testing) {
       Napi::Object m = Napi::Object::New(env);
@@ -261,8 +372,21 @@ Napi::Value send_metrics_core (Napi::Env env, Napi::Array metrics, uint64_t flag
       if (is_summary) {
         m.Set("value", Napi::Number::New(env, value));
       }
+      if (is_distribution) {
+        m.Set("distribution", Napi::Boolean::New(env, true));
+      }
       m.Set("addHostTag", Napi::Boolean::New(env, add_host_tag));
+      if (!service.empty()) {
+        m.Set("service", Napi::String::New(env, service));
+      }
+      if (has_exemplar) {
+        m.Set("exemplar", Napi::String::New(env, trace_id));
+      }
       if (tag_count > 0) {
+        Napi::Object echoTags = Napi::Object::New(env);
+        for (size_t n = 0; n < tag_count; n++) {
+          echoTags.Set(series->keys[n], (*values)[n]);
+        }
         m.Set("tags", echoTags);
       }
       echo[echo.Length()] = m;
@@ -271,7 +395,21 @@ Napi::Value send_metrics_core (Napi::Env env, Napi::Array metrics, uint64_t flag
   }
 
   Napi::Object result = Napi::Object::New(env);
-  result.Set("errors", errors);
+  if (compact) {
+    size_t error_count = error_codes.size();
+    Napi::Uint32Array indexes = Napi::Uint32Array::New(env, error_count);
+    Napi::Uint8Array codes = Napi::Uint8Array::New(env, error_count);
+    if (error_count) {
+      memcpy(indexes.Data(), error_indexes.data(), error_count * sizeof(uint32_t));
+      memcpy(codes.Data(), error_codes.data(), error_count);
+    }
+    Napi::Object e = Napi::Object::New(env);
+    e.Set("indexes", indexes);
+    e.Set("codes", codes);
+    result.Set("errors", e);
+  } else {
+    result.Set("errors", errors);
+  }
   if (testing) {
     result.Set("correct", echo);
   }
@@ -301,6 +439,17 @@ Napi::Value send_metrics_core (Napi::Env env, Napi::Array metrics, uint64_t flag
 //                values if count is greater than 1.
 // metric.addHostTag - boolean (overrides options.addHostTag if present)
 // metric.tags - object of {tag: value} pairs.
+// metric.service - the service name for the metric (default none).
+// metric.distribution - boolean - record value in a native histogram that is
+//                flushed as percentile summaries (requires value). when
+//                count is greater than 1 each observation is recorded as
+//                value / count.
+// metric.exemplar - a sampled Event or trace id (32 hex characters or a
+//                traceparent) kept as an exemplar of the metric's series.
+//
+// options.compactErrors - return errors as {indexes: Uint32Array, codes:
+//                Uint8Array} instead of an array of {code, metric} objects.
+//                getMetricErrorMessage(code) returns the message for a code.
 //
 //
 // c++ - process an array of metrics each with a fully specified set of tags
@@ -324,6 +473,7 @@ Napi::Value sendMetrics(const Napi::CallbackInfo& info) {
     Napi::Object options = info[1].As<Napi::Object>();
     if (options.Get("testing").ToBoolean()) flags |= kSMFlagsTesting;
     if (options.Get("noop").ToBoolean()) flags |= kSMFlagsNoop;
+    if (options.Get("compactErrors").ToBoolean()) flags |= kSMFlagsCompactErrors;
   }
 
   Napi::Array metrics = info[0].As<Napi::Array>();
@@ -331,6 +481,24 @@ Napi::Value sendMetrics(const Napi::CallbackInfo& info) {
   return send_metrics_core(env, metrics, flags);
 }
 
+//
+// JavaScript callable
+//
+// getMetricErrorMessage(code) returns the message for a sendMetrics() compact
+// error code or undefined if the code isn't valid.
+//
+Napi::Value getMetricErrorMessage(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    return env.Undefined();
+  }
+  int64_t code = info[0].As<Napi::Number>().Int64Value();
+  if (code < 1 || code >= kMetricErrorCount) {
+    return env.Undefined();
+  }
+  return Napi::String::New(env, metric_error_messages[code]);
+}
+
 //
 // sendMetric(name, object)
 //
@@ -492,11 +660,32 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
 
   module.Set("sendHttpSpan", Napi::Function::New(env, sendHttpSpan));
   module.Set("sendNonHttpSpan", Napi::Function::New(env, sendNonHttpSpan));
+  module.Set("sendHttpSpans", Napi::Function::New(env, sendHttpSpans));
+  module.Set("sendNonHttpSpans", Napi::Function::New(env, sendNonHttpSpans));
 
   module.Set("sendMetric", Napi::Function::New(env, sendMetric));
   module.Set("sendMetrics", Napi::Function::New(env, sendMetrics));
+  module.Set("getMetricErrorMessage", Napi::Function::New(env, getMetricErrorMessage));
+  module.Set("getSeriesCacheStats", Napi::Function::New(env, SeriesCache::getStats));
+
+  module.Set("getTxnameCacheStats", Napi::Function::New(env, TxnameCache::getStats));
+  module.Set("getSpanHistograms", Napi::Function::New(env, SpanHistograms::get));
+  module.Set("getTopTransactions", Napi::Function::New(env, TopTransactions::get));
+
+  module.Set("flushDistributions", Napi::Function::New(env, Distributions::flushDistributions));
+  module.Set("getDistributionStats", Napi::Function::New(env, Distributions::getStats));
+  module.Set("getMetricExemplars", Napi::Function::New(env, Exemplars::getMetrics));
+
+  module.Set("getCardinalityStats", Napi::Function::New(env, Cardinality::getStats));
+
+  module.Set("flushSharedMetrics", Napi::Function::New(env, SharedMetrics::flushSharedMetrics));
+  module.Set("getSharedMetricsStats", Napi::Function::New(env, SharedMetrics::getStats));
+
+  module.Set("pressure", Napi::Function::New(env, Pressure::pressure));
+  module.Set("getPressureStats", Napi::Function::New(env, Pressure::getStats));
 
   module.Set("flush", Napi::Function::New(env, flush));
+  module.Set("flushAsync", Napi::Function::New(env, flushAsync));
   module.Set("getType", Napi::Function::New(env, getType));
 
   exports.Set("Reporter", module);
@@ -525,14 +714,14 @@ int64_t get_integer(Napi::Object obj, const char* key, int64_t default_value) {
 }
 
 //
-// returns a new std::string that MUST BE DELETED.
+// return a string
 //
-std::string* get_string(Napi::Object obj, const char* key, const char* default_value) {
+std::string get_string(Napi::Object obj, const char* key, const char* default_value) {
   Napi::Value v = obj.Get(key);
   if (v.IsString()) {
-    return new std::string(v.As<Napi::String>());
+    return v.As<Napi::String>();
   }
-  return new std::string(default_value);
+  return default_value;
 }
 
 //
@@ -545,3 +734,27 @@ bool get_boolean(Napi::Object obj, const char* key, bool default_value) {
   }
   return default_value;
 }
+
+//
+// the key is the name, the service, the tags sorted by key, and the host tag
+// flag. the parts are separated by nul characters which can't appear in a name.
+//
+void series_key(std::string& key, const std::string& name, const std::string& service,
+                const std::vector<std::string>& keys, const std::vector<std::string>& values,
+                bool host_tag) {
+  std::vector<size_t> order(keys.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+
+  key.assign(name);
+  key += '\0';
+  key += service;
+  for (size_t i : order) {
+    key += '\0';
+    key += keys[i];
+    key += '=';
+    key += values[i];
+  }
+  key += '\0';
+  key += host_tag ? 'h' : '-';
+}
@@ -0,0 +1,233 @@
+#include "bindings.h"
+#include "reporter/reporter.h"
+#include "uv.h"
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+//
+// Cardinality guard for custom metrics.
+//
+// Each metric name has an exact set of the tag sets (series) seen in the
+// current window, capped at maxSeries, and a HyperLogLog estimate of all
+// the distinct tag sets seen, including those over the cap. A tag set that
+// would exceed the cap is either folded into an "other" series, where every
+// tag value is replaced by "other", or rejected.
+//
+// The windows restart every resetInterval seconds, matching the interval
+// at which oboe flushes custom metrics.
+//
+// oboe aggregates the metrics of every thread together so the guard is
+// process-wide and its state is guarded by a mutex.
+//
+namespace Cardinality {
+
+// HyperLogLog with 2^10 registers, about 3% standard error.
+const int kPrecision = 10;
+const size_t kRegisters = 1 << kPrecision;
+
+struct NameState {
+  std::unordered_set<uint64_t> series;
+  uint8_t registers[kRegisters] = {};
+  uint64_t folded = 0;
+  uint64_t rejected = 0;
+};
+
+static std::atomic<bool> enabled(false);
+
+static std::mutex mutex;
+static size_t max_series = 100;
+static size_t max_names = 1000;
+static bool fold = true;
+static uint64_t reset_interval_ns = UINT64_C(60) * 1000 * 1000 * 1000;
+
+static uint64_t window_start = 0;
+static std::unordered_map<std::string, NameState> names;
+
+// totals across all names, including names over the limit.
+static uint64_t total_folded = 0;
+static uint64_t total_rejected = 0;
+
+//
+// hash a tag set. the pair hashes are summed so the order of the tags
+// doesn't matter. the result is mixed so its bits are well distributed
+// for the HyperLogLog.
+//
+static uint64_t hash_tags(const std::vector<std::string>& keys, const std::vector<std::string>& values) {
+  uint64_t h = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    uint64_t kh = fnv1a(keys[i].data(), keys[i].length()) ^ '=';
+    h += mix64(fnv1a(values[i].data(), values[i].length(), kh));
+  }
+  return mix64(h);
+}
+
+static void hll_add(uint8_t* registers, uint64_t h) {
+  size_t ix = h >> (64 - kPrecision);
+  // the remaining bits with a sentinel so the count of leading zeros is bounded.
+  uint64_t w = (h << kPrecision) | (UINT64_C(1) << (kPrecision - 1));
+  uint8_t rank = __builtin_clzll(w) + 1;
+  if (rank > registers[ix]) {
+    registers[ix] = rank;
+  }
+}
+
+static double hll_estimate(const uint8_t* registers) {
+  const double m = kRegisters;
+  const double alpha = 0.7213 / (1 + 1.079 / m);
+  double sum = 0;
+  size_t zeros = 0;
+  for (size_t i = 0; i < kRegisters; i++) {
+    sum += std::ldexp(1.0, -registers[i]);
+    if (registers[i] == 0) zeros += 1;
+  }
+  double estimate = alpha * m * m / sum;
+  // small range correction (linear counting)
+  if (estimate <= 2.5 * m && zeros) {
+    estimate = m * std::log(m / zeros);
+  }
+  return estimate;
+}
+
+static void maybe_reset() {
+  uint64_t now = uv_hrtime();
+  if (now - window_start >= reset_interval_ns) {
+    names.clear();
+    window_start = now;
+  }
+}
+
+//
+// check a metric's tag set. returns kAccept if the tag set may be sent as
+// is, kFold if every value should be replaced by kFoldedValue, or kReject.
+//
+int check(const std::string& name, const std::vector<std::string>& keys, const std::vector<std::string>& values) {
+  if (!enabled) {
+    return kAccept;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  maybe_reset();
+
+  auto over_limit = [&](NameState* state) {
+    if (!fold) {
+      total_rejected += 1;
+      if (state) state->rejected += 1;
+      return kReject;
+    }
+    total_folded += 1;
+    if (state) state->folded += 1;
+    return kFold;
+  };
+
+  auto it = names.find(name);
+  if (it == names.end()) {
+    if (names.size() >= max_names) {
+      return over_limit(nullptr);
+    }
+    it = names.emplace(name, NameState()).first;
+  }
+  NameState& state = it->second;
+
+  uint64_t h = hash_tags(keys, values);
+  hll_add(state.registers, h);
+
+  if (state.series.count(h)) {
+    return kAccept;
+  }
+  if (state.series.size() >= max_series) {
+    return over_limit(&state);
+  }
+  state.series.insert(h);
+  return kAccept;
+}
+
+//
+// configure from the oboeInit() metricCardinality option which is either
+// false, to disable the guard, or an object:
+//
+// options.maxSeries - most tag sets per metric name in a window (default 100)
+// options.maxNames - most metric names tracked in a window (default 1000)
+// options.overflow - 'other' to fold (default) or 'reject'
+// options.resetInterval - window length in seconds (default 60)
+//
+bool configure(Napi::Value v) {
+  if (v.IsBoolean() && !v.As<Napi::Boolean>().Value()) {
+    std::lock_guard<std::mutex> lock(mutex);
+    enabled = false;
+    names.clear();
+    return true;
+  }
+  if (!v.IsObject() || v.IsArray()) {
+    return false;
+  }
+  Napi::Object o = v.As<Napi::Object>();
+
+  int64_t series = get_integer(o, "maxSeries", 100);
+  int64_t nnames = get_integer(o, "maxNames", 1000);
+  int64_t interval = get_integer(o, "resetInterval", 60);
+  std::string overflow = get_string(o, "overflow", "other");
+  if (series < 0 || nnames < 0 || interval <= 0 || (overflow != "other" && overflow != "reject")) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  max_series = series;
+  max_names = nnames;
+  reset_interval_ns = interval * UINT64_C(1000000000);
+  fold = overflow == "other";
+  enabled = true;
+  names.clear();
+  window_start = uv_hrtime();
+
+  return true;
+}
+
+//
+// JavaScript callable
+//
+// getCardinalityStats(options)
+//
+// options.reset - reset the folded and rejected counts after reading them.
+//
+// returns {folded, rejected, names: {name: {series, estimate, folded, rejected}}}
+// for the current window.
+//
+Napi::Value getStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  bool reset = false;
+  if (info.Length() == 1 && info[0].IsObject()) {
+    reset = info[0].ToObject().Get("reset").ToBoolean().Value();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Napi::Object n = Napi::Object::New(env);
+  for (auto& entry : names) {
+    const NameState& state = entry.second;
+    Napi::Object o = Napi::Object::New(env);
+    o.Set("series", Napi::Number::New(env, state.series.size()));
+    o.Set("estimate", Napi::Number::New(env, std::round(hll_estimate(state.registers))));
+    o.Set("folded", Napi::Number::New(env, state.folded));
+    o.Set("rejected", Napi::Number::New(env, state.rejected));
+    n.Set(entry.first, o);
+  }
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("folded", Napi::Number::New(env, total_folded));
+  o.Set("rejected", Napi::Number::New(env, total_rejected));
+  o.Set("names", n);
+
+  if (reset) {
+    total_folded = 0;
+    total_rejected = 0;
+    for (auto& entry : names) {
+      entry.second.folded = 0;
+      entry.second.rejected = 0;
+    }
+  }
+
+  return o;
+}
+
+} // end namespace Cardinality
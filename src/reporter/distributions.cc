@@ -0,0 +1,379 @@
+#include "bindings.h"
+#include "reporter/reporter.h"
+#include "metrics/hdr_histogram.h"
+#include "uv.h"
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+//
+// Distribution metrics. Each observation sent with sendMetrics() as
+// {name, value, distribution: true} is recorded in a native HDR histogram
+// for its series (name, service, tags and addHostTag). At each interval every series
+// with observations is flushed to oboe as summaries:
+//
+//   name       - the sum and count of the observations
+//   name.p50   - the 50th percentile, and so on for each configured percentile
+//   name.max   - the largest observation
+//
+// Series that receive no observations during an interval are discarded.
+//
+// oboe aggregates the metrics of every thread together so the series are
+// process-wide and guarded by a mutex. The flush timer runs on the loop of
+// one environment at a time.
+//
+namespace Distributions {
+
+// two significant figures keeps each histogram small; values are scaled
+// before recording so fractional values retain precision.
+const int kSignificantFigures = 2;
+const int64_t kHighestTrackable = INT64_C(1000000000000);
+
+struct Percentile {
+  double percentile;
+  std::string suffix;
+};
+
+struct Series {
+  std::string name;
+  std::string service;
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+  bool host_tag = false;
+  struct hdr_histogram* hist = nullptr;
+  double sum = 0;
+  int64_t count = 0;
+};
+
+// guards the series and the settings they're recorded with.
+static std::mutex mutex;
+
+static std::unordered_map<std::string, Series> series;
+static std::vector<Percentile> percentiles = {
+  {50, ".p50"}, {90, ".p90"}, {95, ".p95"}, {99, ".p99"}
+};
+static size_t max_series = 100;
+static double scale = 1000;
+static std::atomic<uint64_t> interval_ms(60 * 1000);
+
+// the environment whose loop runs the timer. it's claimed by the first
+// environment to record a distribution and released when that environment
+// is torn down, when the next environment to record one claims it.
+static std::atomic<napi_env> timer_env(nullptr);
+// only used on timer_env's thread. allocated when it's started and freed
+// when it's closed.
+static uv_timer_t* timer = nullptr;
+static bool timer_running = false;
+
+// reused to build series keys.
+static std::string key;
+
+static void set_percentiles(const std::vector<double>& ps) {
+  percentiles.clear();
+  for (double p : ps) {
+    // 99.9 => ".p999"
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%g", p);
+    std::string suffix = ".p";
+    for (char* c = buf; *c; c++) {
+      if (*c != '.') suffix += *c;
+    }
+    percentiles.push_back({p, suffix});
+  }
+}
+
+//
+// send the series to oboe and reset it.
+//
+static void flush_series(Series& s) {
+  const char* service_name = s.service.c_str();
+  size_t tag_count = s.keys.size();
+  std::vector<oboe_metric_tag_t> otags(tag_count);
+  for (size_t i = 0; i < tag_count; i++) {
+    otags[i].key = (char*)s.keys[i].c_str();
+    otags[i].value = (char*)s.values[i].c_str();
+  }
+
+  oboe_custom_metric_summary(s.name.c_str(), s.sum, s.count, s.host_tag, service_name,
+                             otags.data(), tag_count);
+
+  std::string name;
+  for (auto& p : percentiles) {
+    name = s.name + p.suffix;
+    double value = hdr_value_at_percentile(s.hist, p.percentile) / scale;
+    oboe_custom_metric_summary(name.c_str(), value, 1, s.host_tag, service_name,
+                               otags.data(), tag_count);
+  }
+  name = s.name + ".max";
+  oboe_custom_metric_summary(name.c_str(), hdr_max(s.hist) / scale, 1, s.host_tag,
+                             service_name, otags.data(), tag_count);
+
+  hdr_reset(s.hist);
+  s.sum = 0;
+  s.count = 0;
+}
+
+//
+// flush all series with observations and discard those without.
+//
+size_t flush() {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t flushed = 0;
+  for (auto it = series.begin(); it != series.end();) {
+    if (it->second.count == 0) {
+      hdr_close(it->second.hist);
+      it = series.erase(it);
+      continue;
+    }
+    flush_series(it->second);
+    flushed += 1;
+    ++it;
+  }
+  return flushed;
+}
+
+static void timer_cb(uv_timer_t* handle) {
+  flush();
+  // the interval may have been changed by another environment.
+  uint64_t ms = interval_ms;
+  if (ms == 0) {
+    uv_timer_stop(handle);
+    timer_running = false;
+  } else if (uv_timer_get_repeat(handle) != ms) {
+    uv_timer_set_repeat(handle, ms);
+  }
+}
+
+//
+// flush the last interval and close the timer when its environment goes
+// away; the process may be exiting.
+//
+static void cleanup(void*) {
+  flush();
+  if (timer) {
+    uv_timer_stop(timer);
+    uv_close(reinterpret_cast<uv_handle_t*>(timer), [](uv_handle_t* handle) {
+      delete reinterpret_cast<uv_timer_t*>(handle);
+    });
+    timer = nullptr;
+  }
+  timer_running = false;
+  timer_env.store(nullptr);
+}
+
+static void start_timer(napi_env env) {
+  uint64_t ms = interval_ms;
+  if (ms == 0) {
+    return;
+  }
+  napi_env expected = nullptr;
+  if (timer_env.compare_exchange_strong(expected, env)) {
+    napi_add_env_cleanup_hook(env, cleanup, nullptr);
+  } else if (expected != env) {
+    // the timer belongs to another thread's loop.
+    return;
+  }
+  if (!timer) {
+    uv_loop_t* loop;
+    napi_get_uv_event_loop(env, &loop);
+    timer = new uv_timer_t;
+    uv_timer_init(loop, timer);
+    // don't keep the process alive just to flush distributions.
+    uv_unref(reinterpret_cast<uv_handle_t*>(timer));
+  }
+  if (!timer_running) {
+    uv_timer_start(timer, timer_cb, ms, ms);
+    timer_running = true;
+  }
+}
+
+static void stop_timer(napi_env env) {
+  if (timer_running && env == timer_env.load()) {
+    uv_timer_stop(timer);
+    timer_running = false;
+  }
+}
+
+//
+// record count observations whose values sum to value for the series. each
+// is recorded as the mean. the tag keys and values are parallel vectors.
+//
+// returns 0 on success else an error code.
+//
+int record(Napi::Env env, const std::string& name, const std::string& service, double value, int64_t count,
+           bool host_tag, const std::vector<std::string>& keys, const std::vector<std::string>& values) {
+  if (value < 0 || std::isnan(value) || count < 1) {
+    return kInvalidValue;
+  }
+
+  bool added = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    series_key(key, name, service, keys, values, host_tag);
+
+    auto it = series.find(key);
+    if (it == series.end()) {
+      if (series.size() >= max_series) {
+        return kSeriesLimitExceeded;
+      }
+      Series s;
+      if (hdr_init(1, kHighestTrackable, kSignificantFigures, &s.hist) != 0) {
+        return kSeriesLimitExceeded;
+      }
+      s.name = name;
+      s.service = service;
+      s.keys = keys;
+      s.values = values;
+      s.host_tag = host_tag;
+      it = series.emplace(key, std::move(s)).first;
+      added = true;
+    }
+
+    Series& s = it->second;
+    int64_t scaled = std::llround(value / count * scale);
+    if (scaled < 1) {
+      scaled = 1;
+    } else if (scaled > kHighestTrackable) {
+      scaled = kHighestTrackable;
+    }
+    hdr_record_values(s.hist, scaled, count);
+    s.sum += value;
+    s.count += count;
+  }
+
+  if (added) {
+    start_timer(env);
+  }
+  return 0;
+}
+
+//
+// configure from the oboeInit() distributions option:
+//
+// options.interval - seconds between flushes, 0 to only flush when
+//                    flushDistributions() is called (default 60)
+// options.percentiles - array of percentiles to report (default [50, 90, 95, 99])
+// options.maxSeries - most series tracked (default 100)
+// options.scale - values are multiplied by this before recording; it sets
+//                 the smallest distinguishable value (default 1000)
+//
+bool configure(Napi::Value v) {
+  if (!v.IsObject() || v.IsArray()) {
+    return false;
+  }
+  Napi::Object o = v.As<Napi::Object>();
+
+  std::vector<double> ps;
+  if (o.Has("percentiles")) {
+    Napi::Value p = o.Get("percentiles");
+    if (!p.IsArray()) {
+      return false;
+    }
+    Napi::Array a = p.As<Napi::Array>();
+    for (uint32_t i = 0; i < a.Length(); i++) {
+      Napi::Value n = a[i];
+      if (!n.IsNumber()) {
+        return false;
+      }
+      double d = n.As<Napi::Number>().DoubleValue();
+      if (!(d > 0 && d <= 100)) {
+        return false;
+      }
+      ps.push_back(d);
+    }
+  } else {
+    ps = {50, 90, 95, 99};
+  }
+
+  int64_t interval = get_integer(o, "interval", 60);
+  int64_t max = get_integer(o, "maxSeries", 100);
+  double s = 1000;
+  Napi::Value sv = o.Get("scale");
+  if (sv.IsNumber()) {
+    s = sv.As<Napi::Number>().DoubleValue();
+  }
+  if (interval < 0 || max < 0 || !(s > 0)) {
+    return false;
+  }
+
+  // existing series were recorded with the previous settings.
+  flush();
+  stop_timer(v.Env());
+
+  bool have_series;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    set_percentiles(ps);
+    max_series = max;
+    scale = s;
+    have_series = !series.empty();
+  }
+  interval_ms = interval * 1000;
+
+  if (have_series) {
+    start_timer(v.Env());
+  }
+  return true;
+}
+
+//
+// JavaScript callable
+//
+// flushDistributions() flushes all series immediately and returns the
+// number of series flushed.
+//
+Napi::Value flushDistributions(const Napi::CallbackInfo& info) {
+  return Napi::Number::New(info.Env(), flush());
+}
+
+//
+// JavaScript callable
+//
+// getDistributionStats(options) returns {series, maxSeries}
+//
+// options.values - also return values, an array of {name, service, tags,
+//                  addHostTag, count, sum, max} for the series with
+//                  observations since the last flush.
+//
+Napi::Value getStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  bool with_values = false;
+  if (info.Length() == 1 && info[0].IsObject()) {
+    with_values = info[0].ToObject().Get("values").ToBoolean().Value();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("series", Napi::Number::New(env, series.size()));
+  o.Set("maxSeries", Napi::Number::New(env, max_series));
+
+  if (with_values) {
+    Napi::Array a = Napi::Array::New(env);
+    uint32_t i = 0;
+    for (auto& entry : series) {
+      const Series& s = entry.second;
+      if (s.count == 0) {
+        continue;
+      }
+      Napi::Object tags = Napi::Object::New(env);
+      for (size_t n = 0; n < s.keys.size(); n++) {
+        tags.Set(s.keys[n], s.values[n]);
+      }
+      Napi::Object v = Napi::Object::New(env);
+      v.Set("name", Napi::String::New(env, s.name));
+      v.Set("service", Napi::String::New(env, s.service));
+      v.Set("tags", tags);
+      v.Set("addHostTag", Napi::Boolean::New(env, s.host_tag));
+      v.Set("count", Napi::Number::New(env, s.count));
+      v.Set("sum", Napi::Number::New(env, s.sum));
+      v.Set("max", Napi::Number::New(env, hdr_max(s.hist) / scale));
+      a.Set(i++, v);
+    }
+    o.Set("values", a);
+  }
+  return o;
+}
+
+} // end namespace Distributions
@@ -0,0 +1,246 @@
+#include "bindings.h"
+#include "reporter/reporter.h"
+#include <cctype>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+//
+// Exemplars link aggregated values to traces. A span or custom metric may
+// carry a sampled Event or a trace id as its exemplar; each series keeps the
+// exemplar with the largest value and the most recent exemplar until the
+// series is read with a reset.
+//
+// Span exemplars are kept with the span histograms. Custom metrics are
+// aggregated by oboe so their exemplars are kept here, per series, and read
+// with getMetricExemplars(). Metrics are sent from every thread so those
+// series are guarded by a mutex; span reservoirs are guarded by the span
+// histograms' own.
+//
+namespace Exemplars {
+
+struct MetricSeries {
+  std::string name;
+  std::string service;
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+  bool host_tag = false;
+  Reservoir reservoir;
+};
+
+std::atomic<bool> enabled(true);
+
+static std::mutex mutex;
+static size_t max_series = 1000;
+
+static std::unordered_map<std::string, MetricSeries> series;
+
+// series not kept because the limit was reached.
+static uint64_t untracked = 0;
+
+// reused to build series keys.
+static std::string key;
+
+static double now_ms() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+void Reservoir::offer(const std::string& trace_id, double value) {
+  if (!enabled) {
+    return;
+  }
+  double timestamp = now_ms();
+  if (!has || value >= max.value) {
+    max.trace_id = trace_id;
+    max.value = value;
+    max.timestamp = timestamp;
+  }
+  latest.trace_id = trace_id;
+  latest.value = value;
+  latest.timestamp = timestamp;
+  has = true;
+}
+
+static Napi::Value exemplar_value(Napi::Env env, const Exemplar& e) {
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("traceId", Napi::String::New(env, e.trace_id));
+  o.Set("value", Napi::Number::New(env, e.value));
+  o.Set("timestamp", Napi::Number::New(env, e.timestamp));
+  return o;
+}
+
+//
+// returns {max, latest} or null if there are no exemplars.
+//
+Napi::Value Reservoir::toValue(Napi::Env env) const {
+  if (!has) {
+    return env.Null();
+  }
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("max", exemplar_value(env, max));
+  o.Set("latest", exemplar_value(env, latest));
+  return o;
+}
+
+static bool is_hex(const std::string& s, size_t start, size_t length) {
+  for (size_t i = start; i < start + length; i++) {
+    if (!isxdigit((unsigned char)s[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//
+// get a lowercase trace id from a string that is either a 32 character
+// trace id or a W3C traceparent. returns false if the string is neither or
+// if the traceparent isn't sampled.
+//
+bool parse(const std::string& s, std::string& trace_id) {
+  size_t start;
+  if (s.length() == 32 && is_hex(s, 0, 32)) {
+    start = 0;
+  } else if (s.length() == 55 && s[2] == '-' && s[35] == '-' && s[52] == '-'
+             && is_hex(s, 0, 2) && is_hex(s, 3, 32) && is_hex(s, 36, 16) && is_hex(s, 53, 2)) {
+    // the sampled bit is the low bit of the flags.
+    if (!(std::stoi(s.substr(53, 2), nullptr, 16) & 1)) {
+      return false;
+    }
+    start = 3;
+  } else {
+    return false;
+  }
+  trace_id.assign(s, start, 32);
+  for (char& c : trace_id) {
+    c = tolower(c);
+  }
+  return true;
+}
+
+//
+// get a trace id from an exemplar that is an Event or a string. returns
+// false if there is no usable exemplar; exemplars are best effort so an
+// invalid one is ignored rather than treated as an error.
+//
+bool traceId(Napi::Value v, std::string& trace_id) {
+  if (!enabled) {
+    return false;
+  }
+  if (v.IsString()) {
+    return parse(v.As<Napi::String>().Utf8Value(), trace_id);
+  }
+  if (v.IsObject()) {
+    return Event::getSampledTraceId(v.As<Napi::Object>(), trace_id);
+  }
+  return false;
+}
+
+//
+// offer an exemplar for a custom metric series.
+//
+void offerMetric(const std::string& name, const std::string& service,
+                 const std::vector<std::string>& keys, const std::vector<std::string>& values,
+                 bool host_tag, double value, const std::string& trace_id) {
+  if (!enabled) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  series_key(key, name, service, keys, values, host_tag);
+
+  auto it = series.find(key);
+  if (it == series.end()) {
+    if (series.size() >= max_series) {
+      untracked += 1;
+      return;
+    }
+    MetricSeries s;
+    s.name = name;
+    s.service = service;
+    s.keys = keys;
+    s.values = values;
+    s.host_tag = host_tag;
+    it = series.emplace(key, std::move(s)).first;
+  }
+  it->second.reservoir.offer(trace_id, value);
+}
+
+//
+// configure from the oboeInit() exemplars option which is either a boolean
+// or an object:
+//
+// options.maxSeries - most custom metric series with exemplars (default 1000)
+//
+bool configure(Napi::Value v) {
+  bool e = true;
+  int64_t max = -1;
+  if (v.IsBoolean()) {
+    e = v.As<Napi::Boolean>().Value();
+  } else if (v.IsObject() && !v.IsArray()) {
+    max = get_integer(v.As<Napi::Object>(), "maxSeries", 1000);
+    if (max < 0) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (max >= 0) {
+    max_series = max;
+  }
+  enabled = e;
+  series.clear();
+  untracked = 0;
+  return true;
+}
+
+//
+// JavaScript callable
+//
+// getMetricExemplars(options)
+//
+// options.reset - start a new interval after reading the exemplars.
+//
+// returns {series: [{name, service, tags, addHostTag, exemplars: {max, latest}}], untracked}
+// where max and latest are {traceId, value, timestamp}. for summaries the
+// value is the metric's value; for increments it's the count.
+//
+Napi::Value getMetrics(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  bool reset = false;
+  if (info.Length() == 1 && info[0].IsObject()) {
+    reset = info[0].ToObject().Get("reset").ToBoolean().Value();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Napi::Array a = Napi::Array::New(env, series.size());
+  uint32_t i = 0;
+  for (auto& entry : series) {
+    const MetricSeries& s = entry.second;
+    Napi::Object tags = Napi::Object::New(env);
+    for (size_t n = 0; n < s.keys.size(); n++) {
+      tags.Set(s.keys[n], s.values[n]);
+    }
+    Napi::Object o = Napi::Object::New(env);
+    o.Set("name", Napi::String::New(env, s.name));
+    o.Set("service", Napi::String::New(env, s.service));
+    o.Set("tags", tags);
+    o.Set("addHostTag", Napi::Boolean::New(env, s.host_tag));
+    o.Set("exemplars", s.reservoir.toValue(env));
+    a.Set(i++, o);
+  }
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("series", a);
+  o.Set("untracked", Napi::Number::New(env, untracked));
+
+  if (reset) {
+    series.clear();
+    untracked = 0;
+  }
+
+  return o;
+}
+
+} // end namespace Exemplars
@@ -0,0 +1,162 @@
+#include "bindings.h"
+#include "reporter/reporter.h"
+#include "uv.h"
+#include <chrono>
+#include <cstdlib>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+//
+// Asynchronous version of Reporter.flush().
+//
+// oboe_reporter_flush() can't be interrupted so it runs on its own thread.
+// The AsyncWorker waits for it, but only until the deadline; if the deadline
+// passes the promise is resolved and the flush is left to finish in the
+// background. A flush requested while a previous one is still running waits
+// for that one rather than starting another.
+//
+
+const int kFlushTimedOut = -1;
+
+// how long to wait when no timeout is given, so a flush that never returns
+// can't hold a threadpool thread forever.
+const int64_t kDefaultTimeoutMs = 30 * 1000;
+
+//
+// state shared by a flush thread and the workers waiting on it.
+//
+struct FlushState {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool done = false;
+  int status = 0;
+};
+
+static std::mutex in_progress_mutex;
+static std::shared_ptr<FlushState> in_progress;
+
+//
+// get the flush in progress or start a new one.
+//
+static std::shared_ptr<FlushState> start_flush(int64_t stall_ms) {
+  std::lock_guard<std::mutex> lock(in_progress_mutex);
+  if (in_progress) {
+    return in_progress;
+  }
+  std::shared_ptr<FlushState> state = std::make_shared<FlushState>();
+  in_progress = state;
+
+  std::thread([state, stall_ms]() {
+    if (stall_ms > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(stall_ms));
+    }
+    int status = oboe_reporter_flush();
+    {
+      std::lock_guard<std::mutex> lock(in_progress_mutex);
+      in_progress.reset();
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->status = status;
+    state->done = true;
+    state->cv.notify_all();
+  }).detach();
+
+  return state;
+}
+
+class FlushWorker : public Napi::AsyncWorker {
+ public:
+  FlushWorker(Napi::Env env, int64_t timeout_ms, int64_t stall_ms)
+    : Napi::AsyncWorker(env, "flushAsync"),
+      deferred(Napi::Promise::Deferred::New(env)),
+      timeout_ms(timeout_ms),
+      stall_ms(stall_ms),
+      start(uv_hrtime()) {}
+
+  Napi::Promise Promise() {
+    return deferred.Promise();
+  }
+
+  // runs on a libuv threadpool thread.
+  void Execute() override {
+    std::shared_ptr<FlushState> state = start_flush(stall_ms);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    auto done = [&state]() { return state->done; };
+    state->cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), done);
+    status = state->done ? state->status : kFlushTimedOut;
+    timed_out = !state->done;
+    elapsed = uv_hrtime() - start;
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    Napi::Object o = Napi::Object::New(env);
+    o.Set("status", Napi::Number::New(env, status));
+    o.Set("timedOut", Napi::Boolean::New(env, timed_out));
+    // elapsed time in milliseconds
+    o.Set("elapsed", Napi::Number::New(env, elapsed / 1e6));
+    deferred.Resolve(o);
+  }
+
+  void OnError(const Napi::Error& e) override {
+    deferred.Reject(e.Value());
+  }
+
+ private:
+  Napi::Promise::Deferred deferred;
+  int64_t timeout_ms;
+  int64_t stall_ms;
+  uint64_t start;
+
+  int status = 0;
+  bool timed_out = false;
+  uint64_t elapsed = 0;
+};
+
+//
+// a new flush can be delayed by setting SW_APM_TEST_FLUSH_STALL_MS so tests
+// can reach the deadline. it's read on the JavaScript thread.
+//
+static int64_t test_stall_ms() {
+  const char* stall = getenv("SW_APM_TEST_FLUSH_STALL_MS");
+  return stall ? atoll(stall) : 0;
+}
+
+//
+// JavaScript callable
+//
+// flushAsync(options) returns a promise
+//
+// options.timeoutMs - give up waiting after this many milliseconds
+//                     (default 30000).
+//
+// the promise resolves to {status, timedOut, elapsed}. status is the same
+// as the value returned by flush() or -1 if the flush timed out. elapsed is
+// in milliseconds.
+//
+Napi::Value flushAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  int64_t timeout_ms = kDefaultTimeoutMs;
+  if (info.Length() >= 1 && info[0].IsObject()) {
+    Napi::Value v = info[0].ToObject().Get("timeoutMs");
+    if (v.IsNumber()) {
+      timeout_ms = v.As<Napi::Number>().Int64Value();
+      if (timeout_ms < 0) {
+        timeout_ms = 0;
+      }
+    } else if (!v.IsUndefined()) {
+      Napi::TypeError::New(env, "flushAsync() - timeoutMs must be a number").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+
+  FlushWorker* worker = new FlushWorker(env, timeout_ms, test_stall_ms());
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+
+  return promise;
+}
@@ -0,0 +1,174 @@
+#include "bindings.h"
+#include "reporter/reporter.h"
+#include "uv.h"
+#include <atomic>
+
+//
+// Back-pressure from oboe's event queue.
+//
+// The number of free slots in oboe's event queue is sampled at most once
+// per refresh interval and compared to two watermarks. Below the low
+// watermark low-priority events (non-root info events) are dropped before
+// any encoding work is done; below the critical watermark all events other
+// than status events, and all custom metrics, are dropped.
+//
+// The policy is off until watermarks are configured with the oboeInit()
+// backpressure option.
+//
+// Events are sent from every thread. The state is kept in atomics so the
+// check made for each event doesn't take a lock; only one thread at a time
+// samples the queue.
+//
+namespace Pressure {
+
+static std::atomic<int64_t> low_watermark(0);
+static std::atomic<int64_t> critical_watermark(0);
+static std::atomic<uint64_t> refresh_ns(10 * 1000 * 1000);
+
+static std::atomic<uint64_t> last_refresh(0);
+// set while a thread is refreshing.
+static std::atomic<bool> refreshing(false);
+static std::atomic<int> level(kNone);
+static std::atomic<int64_t> queue_free(-1);
+
+static std::atomic<uint64_t> dropped_events(0);
+static std::atomic<uint64_t> dropped_metrics(0);
+
+static void refresh() {
+  oboe_internal_stats_t* stats = oboe_get_internal_stats();
+
+  // no reporter, no queue to apply pressure.
+  if (stats == NULL || stats->reporters_initialized == 0) {
+    queue_free = -1;
+    level = kNone;
+    return;
+  }
+
+  int64_t slots = stats->event_queue_free;
+  queue_free = slots;
+  if (slots < critical_watermark) {
+    level = kCritical;
+  } else if (slots < low_watermark) {
+    level = kLow;
+  } else {
+    level = kNone;
+  }
+}
+
+//
+// get the current pressure level, refreshing it if it's stale.
+//
+int current() {
+  if (!low_watermark && !critical_watermark) {
+    return kNone;
+  }
+  uint64_t now = uv_hrtime();
+  if (now - last_refresh >= refresh_ns && !refreshing.exchange(true, std::memory_order_acquire)) {
+    refresh();
+    last_refresh = now;
+    refreshing.store(false, std::memory_order_release);
+  }
+  return level.load(std::memory_order_relaxed);
+}
+
+//
+// should an event be dropped? status events are never dropped.
+//
+bool dropEvent(int channel, bool low_priority) {
+  if (channel == OBOE_SEND_STATUS) {
+    return false;
+  }
+  int l = current();
+  if (l == kCritical || (l == kLow && low_priority)) {
+    dropped_events.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+//
+// should a custom metric be dropped?
+//
+bool dropMetric() {
+  if (current() == kCritical) {
+    dropped_metrics.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+//
+// configure from the oboeInit() backpressure option:
+//
+// options.lowWatermark - free queue slots below which low-priority events
+//                        are dropped
+// options.criticalWatermark - free queue slots below which all events and
+//                             metrics are dropped
+// options.refreshMs - how often the queue is sampled (default 10)
+//
+// false disables the policy.
+//
+bool configure(Napi::Value v) {
+  if (v.IsBoolean() && !v.As<Napi::Boolean>().Value()) {
+    low_watermark = 0;
+    critical_watermark = 0;
+  } else if (v.IsObject() && !v.IsArray()) {
+    Napi::Object o = v.As<Napi::Object>();
+    int64_t low = get_integer(o, "lowWatermark", 0);
+    int64_t critical = get_integer(o, "criticalWatermark", 0);
+    int64_t refresh_ms = get_integer(o, "refreshMs", 10);
+    if (low < 0 || critical < 0 || refresh_ms < 0) {
+      return false;
+    }
+    // the low watermark is never below the critical watermark.
+    low_watermark = low > critical ? low : critical;
+    critical_watermark = critical;
+    refresh_ns = refresh_ms * 1000 * 1000;
+  } else {
+    return false;
+  }
+  last_refresh = 0;
+  level = kNone;
+  queue_free = -1;
+  return true;
+}
+
+//
+// JavaScript callable
+//
+// pressure() returns the current level: 0 none, 1 low, 2 critical.
+//
+Napi::Value pressure(const Napi::CallbackInfo& info) {
+  return Napi::Number::New(info.Env(), current());
+}
+
+//
+// JavaScript callable
+//
+// getPressureStats(options)
+//
+// options.reset - reset the dropped counts after reading them.
+//
+Napi::Value getStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  bool reset = false;
+  if (info.Length() == 1 && info[0].IsObject()) {
+    reset = info[0].ToObject().Get("reset").ToBoolean().Value();
+  }
+  // read and reset each count in one step so no drops are lost between.
+  uint64_t events = reset ? dropped_events.exchange(0) : dropped_events.load();
+  uint64_t metrics = reset ? dropped_metrics.exchange(0) : dropped_metrics.load();
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("level", Napi::Number::New(env, current()));
+  o.Set("eventQueueFree", Napi::Number::New(env, queue_free.load()));
+  o.Set("lowWatermark", Napi::Number::New(env, low_watermark.load()));
+  o.Set("criticalWatermark", Napi::Number::New(env, critical_watermark.load()));
+  o.Set("droppedEvents", Napi::Number::New(env, events));
+  o.Set("droppedMetrics", Napi::Number::New(env, metrics));
+
+  return o;
+}
+
+} // end namespace Pressure
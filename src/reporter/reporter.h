@@ -0,0 +1,222 @@
+#ifndef NODE_OBOE_REPORTER_H_
+#define NODE_OBOE_REPORTER_H_
+
+#include "bindings.h"
+#include <atomic>
+#include <vector>
+
+//
+// declarations shared by the files that implement the Reporter namespace.
+//
+
+// helpers to fetch typed values from JavaScript objects.
+int64_t get_integer(Napi::Object, const char*, int64_t = 0);
+std::string get_string(Napi::Object, const char*, const char* = "");
+bool get_boolean(Napi::Object obj, const char*, bool = false);
+
+// 64 bit FNV-1a hash.
+inline uint64_t fnv1a(const char* s, size_t length, uint64_t h = UINT64_C(0xcbf29ce484222325)) {
+  for (size_t i = 0; i < length; i++) {
+    h ^= (unsigned char)s[i];
+    h *= UINT64_C(0x100000001b3);
+  }
+  return h;
+}
+
+// finalizer that mixes all the bits of a hash.
+inline uint64_t mix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= UINT64_C(0xff51afd7ed558ccd);
+  h ^= h >> 33;
+  h *= UINT64_C(0xc4ceb9fe1a85ec53);
+  h ^= h >> 33;
+  return h;
+}
+
+// build the key that identifies a custom metric series.
+void series_key(std::string&, const std::string&, const std::string&,
+                const std::vector<std::string>&, const std::vector<std::string>&, bool);
+
+//
+// prepared custom metric series, cached so repeated series skip converting
+// their tags.
+//
+namespace SeriesCache {
+  struct Series {
+    uint64_t hash = 0;
+    std::string name;
+    std::string service;
+    bool host_tag = false;
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+    // points into keys and values
+    std::vector<oboe_metric_tag_t> otags;
+  };
+
+  Series* get(Napi::Env, const std::string&, const std::string&, bool, Napi::Object);
+  bool configure(Napi::Value);
+  Napi::Value getStats(const Napi::CallbackInfo&);
+}
+
+//
+// exemplars link aggregated values to sampled traces.
+//
+namespace Exemplars {
+  extern std::atomic<bool> enabled;
+
+  struct Exemplar {
+    std::string trace_id;
+    double value = 0;
+    // milliseconds since the epoch
+    double timestamp = 0;
+  };
+
+  // the largest and the most recent exemplar of a series.
+  struct Reservoir {
+    bool has = false;
+    Exemplar max;
+    Exemplar latest;
+
+    void offer(const std::string&, double);
+    void clear() { has = false; }
+    Napi::Value toValue(Napi::Env) const;
+  };
+
+  bool parse(const std::string&, std::string&);
+  bool traceId(Napi::Value, std::string&);
+  void offerMetric(const std::string&, const std::string&, const std::vector<std::string>&,
+                   const std::vector<std::string>&, bool, double, const std::string&);
+  bool configure(Napi::Value);
+  Napi::Value getMetrics(const Napi::CallbackInfo&);
+}
+
+//
+// spans
+//
+
+// holds the strings that oboe_span_params_t points to.
+struct SpanStrings {
+  std::string txname;
+  std::string url;
+  std::string domain;
+  std::string method;
+  std::string service;
+  // the exemplar's trace id, empty if none.
+  std::string trace_id;
+};
+
+void get_span_params(Napi::Object, SpanStrings&, oboe_span_params_t&);
+int send_span_core(send_generic_span_t, char*, uint16_t, oboe_span_params_t*, const char* = "");
+
+// batch versions of sendHttpSpan() and sendNonHttpSpan()
+Napi::Value sendHttpSpans(const Napi::CallbackInfo&);
+Napi::Value sendNonHttpSpans(const Napi::CallbackInfo&);
+
+//
+// final transaction names are interned as persistent JavaScript strings.
+//
+namespace TxnameCache {
+  Napi::String get(Napi::Env, const char*);
+  void setCapacity(size_t);
+  Napi::Value getStats(const Napi::CallbackInfo&);
+}
+
+//
+// urls of HTTP spans without a transaction name can be normalized natively.
+//
+namespace TxnameNormalizer {
+  bool normalize(const char*, char*, size_t);
+  bool configure(Napi::Value);
+}
+
+//
+// local latency histograms of the spans sent.
+//
+namespace SpanHistograms {
+  extern std::atomic<bool> enabled;
+
+  void record(const char*, int64_t, bool, const char*);
+  bool configure(Napi::Value);
+  Napi::Value get(const Napi::CallbackInfo&);
+}
+
+//
+// approximate top-K transactions by span count.
+//
+namespace TopTransactions {
+  void record(const char*, int64_t);
+  bool configure(Napi::Value);
+  Napi::Value get(const Napi::CallbackInfo&);
+}
+
+//
+// limits the number of tag sets per custom metric name.
+//
+namespace Cardinality {
+  enum Result {
+    kAccept = 0,
+    kFold = 1,
+    kReject = 2
+  };
+
+  // the value of every tag of a folded series.
+  const char* const kFoldedValue = "other";
+
+  int check(const std::string&, const std::vector<std::string>&, const std::vector<std::string>&);
+  bool configure(Napi::Value);
+  Napi::Value getStats(const Napi::CallbackInfo&);
+}
+
+//
+// back-pressure from oboe's event queue.
+//
+namespace Pressure {
+  enum Level {
+    kNone = 0,
+    kLow = 1,
+    kCritical = 2
+  };
+
+  // status returned when an event is dropped
+  const int kEventDropped = -3000;
+
+  int current();
+  bool dropEvent(int, bool);
+  bool dropMetric();
+  bool configure(Napi::Value);
+  Napi::Value pressure(const Napi::CallbackInfo&);
+  Napi::Value getStats(const Napi::CallbackInfo&);
+}
+
+//
+// distribution metrics are aggregated in native histograms.
+//
+namespace Distributions {
+  // record() error codes
+  const int kInvalidValue = 1;
+  const int kSeriesLimitExceeded = 2;
+
+  int record(Napi::Env, const std::string&, const std::string&, double, int64_t, bool,
+             const std::vector<std::string>&, const std::vector<std::string>&);
+  size_t flush();
+  bool configure(Napi::Value);
+  Napi::Value flushDistributions(const Napi::CallbackInfo&);
+  Napi::Value getStats(const Napi::CallbackInfo&);
+}
+
+//
+// custom metrics aggregated in shared memory by the processes on a host.
+//
+namespace SharedMetrics {
+  bool record(const std::string&, const std::string&, const std::vector<std::string>&,
+              const std::vector<std::string>&, bool, bool, double, int64_t);
+  size_t flush();
+  bool configure(Napi::Value);
+  Napi::Value flushSharedMetrics(const Napi::CallbackInfo&);
+  Napi::Value getStats(const Napi::CallbackInfo&);
+}
+
+// flush without blocking the event loop
+Napi::Value flushAsync(const Napi::CallbackInfo&);
+
+#endif  // NODE_OBOE_REPORTER_H_
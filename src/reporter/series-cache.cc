@@ -0,0 +1,330 @@
+#include "bindings.h"
+#include "reporter/reporter.h"
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+
+//
+// Cache of prepared custom metric series.
+//
+// A series is identified by a hash of its name, service, host tag flag and
+// tags. The tags are hashed straight from the JavaScript values; strings are
+// read into a stack buffer and numbers are hashed without being converted.
+// On a hit the already converted tag strings and oboe_metric_tag_t array are
+// reused so the tags aren't converted to std::strings again.
+//
+// The least recently used series is evicted when the cache is full. Each
+// environment that loads the addon has its own cache.
+//
+namespace SeriesCache {
+
+// set by oboeInit() and shared by all environments. each change bumps the
+// generation so every environment empties its cache on its next use.
+static std::atomic<bool> enabled(true);
+static std::atomic<size_t> capacity(1000);
+static std::atomic<uint32_t> generation(0);
+
+//
+// each environment has its own cache because the series are used by the
+// thread that owns the environment.
+//
+struct Cache {
+  // most recently used first. list nodes don't move, so the otags pointers
+  // into each series' strings stay valid.
+  std::list<Series> lru;
+  std::unordered_map<uint64_t, std::list<Series>::iterator> positions;
+
+  // used for every series when the cache is disabled.
+  Series scratch;
+
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  uint32_t generation = 0;
+
+  void clear() {
+    lru.clear();
+    positions.clear();
+  }
+};
+
+static Cache& get_cache(Napi::Env env) {
+  InstanceData* data = instance_data(env);
+  if (!data->series) {
+    data->series = new Cache;
+    data->series->generation = generation.load();
+  }
+  Cache& cache = *data->series;
+  uint32_t g = generation.load();
+  if (cache.generation != g) {
+    cache.clear();
+    cache.generation = g;
+  }
+  return cache;
+}
+
+//
+// called when the environment's instance data is deleted.
+//
+void destroy(Cache* cache) {
+  delete cache;
+}
+
+//
+// hash a key or value. strings and numbers are hashed without creating a
+// std::string; anything else is converted as oboe will see it.
+//
+static bool hash_value(Napi::Env env, Napi::Value v, uint64_t seed, uint64_t& h) {
+  if (v.IsString()) {
+    char buf[256];
+    size_t len;
+    napi_status status = napi_get_value_string_utf8(env, v, buf, sizeof(buf), &len);
+    if (status != napi_ok) {
+      return false;
+    }
+    if (len < sizeof(buf) - 1) {
+      h = fnv1a(buf, len, seed ^ 's');
+      return true;
+    }
+    // too long for the buffer.
+    std::string s = v.As<Napi::String>().Utf8Value();
+    h = fnv1a(s.data(), s.length(), seed ^ 's');
+    return true;
+  }
+  if (v.IsNumber()) {
+    double d = v.As<Napi::Number>().DoubleValue();
+    char bytes[sizeof(d)];
+    memcpy(bytes, &d, sizeof(d));
+    h = fnv1a(bytes, sizeof(bytes), seed ^ 'n');
+    return true;
+  }
+  Napi::String s = v.ToString();
+  if (env.IsExceptionPending()) {
+    env.GetAndClearPendingException();
+    return false;
+  }
+  std::string str = s.Utf8Value();
+  h = fnv1a(str.data(), str.length(), seed ^ 's');
+  return true;
+}
+
+//
+// hash the identity of a series. the tag pair hashes are summed so the
+// order of the tags doesn't matter.
+//
+static bool hash_series(Napi::Env env, const std::string& name, const std::string& service,
+                        bool host_tag, Napi::Object tags, Napi::Array keys, uint64_t& h) {
+  uint64_t sum = 0;
+  uint32_t tag_count = keys.IsEmpty() ? 0 : keys.Length();
+  for (uint32_t i = 0; i < tag_count; i++) {
+    Napi::Value key = keys[i];
+    uint64_t kh;
+    uint64_t vh;
+    if (!hash_value(env, key, 0, kh) || !hash_value(env, tags.Get(key), kh, vh)) {
+      return false;
+    }
+    sum += mix64(vh);
+  }
+  h = fnv1a(name.data(), name.length());
+  h = fnv1a(service.data(), service.length(), h ^ '\0');
+  h = mix64(h ^ mix64(sum) ^ (host_tag ? 'h' : '-'));
+  return true;
+}
+
+//
+// convert the tags to strings and fill in oboe's tag array.
+//
+static bool prepare(Series& s, Napi::Env env, const std::string& name, const std::string& service,
+                    bool host_tag, Napi::Object tags, Napi::Array keys) {
+  size_t tag_count = keys.IsEmpty() ? 0 : keys.Length();
+  s.name = name;
+  s.service = service;
+  s.host_tag = host_tag;
+  s.keys.resize(tag_count);
+  s.values.resize(tag_count);
+  s.otags.resize(tag_count);
+
+  for (size_t n = 0; n < tag_count; n++) {
+    Napi::Value key = keys[n];
+    s.keys[n] = key.ToString();
+    s.values[n] = tags.Get(key).ToString();
+    // i don't know how ToString() can fail but the doc says
+    // it can so let's try to handle it.
+    if (env.IsExceptionPending()) {
+      env.GetAndClearPendingException();
+      return false;
+    }
+  }
+  for (size_t n = 0; n < tag_count; n++) {
+    s.otags[n].key = (char*)s.keys[n].c_str();
+    s.otags[n].value = (char*)s.values[n].c_str();
+  }
+  return true;
+}
+
+//
+// compare a JavaScript value with a tag string as prepare() would convert
+// it. short strings are compared from a stack buffer.
+//
+static bool same_string(Napi::Env env, Napi::Value v, const std::string& s) {
+  if (v.IsString()) {
+    char buf[256];
+    size_t len;
+    napi_status status = napi_get_value_string_utf8(env, v, buf, sizeof(buf), &len);
+    if (status != napi_ok) {
+      return false;
+    }
+    if (len < sizeof(buf) - 1) {
+      return len == s.length() && memcmp(buf, s.data(), len) == 0;
+    }
+  }
+  Napi::String str = v.ToString();
+  if (env.IsExceptionPending()) {
+    env.GetAndClearPendingException();
+    return false;
+  }
+  return str.Utf8Value() == s;
+}
+
+//
+// check that a cached series really is the one being looked up, not one
+// whose hash collided with it. the tags can be in any order.
+//
+static bool same_series(const Series& s, Napi::Env env, const std::string& name,
+                        const std::string& service, bool host_tag, Napi::Object tags,
+                        Napi::Array keys) {
+  size_t tag_count = keys.IsEmpty() ? 0 : keys.Length();
+  if (s.name != name || s.service != service || s.host_tag != host_tag
+      || s.keys.size() != tag_count) {
+    return false;
+  }
+  for (uint32_t i = 0; i < tag_count; i++) {
+    Napi::Value key = keys[i];
+    size_t n = 0;
+    while (n < tag_count && !same_string(env, key, s.keys[n])) {
+      n += 1;
+    }
+    if (n == tag_count || !same_string(env, tags.Get(key), s.values[n])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//
+// get the prepared series for a metric. tags is empty if the metric has
+// no tags. returns nullptr if the tags can't be converted.
+//
+// the series is valid until the next call.
+//
+Series* get(Napi::Env env, const std::string& name, const std::string& service,
+            bool host_tag, Napi::Object tags) {
+  Napi::Array keys;
+  if (!tags.IsEmpty()) {
+    keys = tags.GetPropertyNames();
+  }
+
+  Cache& cache = get_cache(env);
+
+  if (!enabled) {
+    Series& scratch = cache.scratch;
+    return prepare(scratch, env, name, service, host_tag, tags, keys) ? &scratch : nullptr;
+  }
+
+  uint64_t h;
+  if (!hash_series(env, name, service, host_tag, tags, keys, h)) {
+    return nullptr;
+  }
+
+  auto it = cache.positions.find(h);
+  if (it != cache.positions.end()) {
+    Series& s = *it->second;
+    // guard against a hash collision with a different series.
+    if (same_series(s, env, name, service, host_tag, tags, keys)) {
+      cache.hits += 1;
+      cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+      return &s;
+    }
+    cache.lru.erase(it->second);
+    cache.positions.erase(it);
+  }
+
+  cache.misses += 1;
+  cache.lru.emplace_front();
+  if (!prepare(cache.lru.front(), env, name, service, host_tag, tags, keys)) {
+    cache.lru.pop_front();
+    return nullptr;
+  }
+  cache.lru.front().hash = h;
+  cache.positions[h] = cache.lru.begin();
+
+  if (cache.lru.size() > capacity) {
+    cache.positions.erase(cache.lru.back().hash);
+    cache.lru.pop_back();
+    cache.evictions += 1;
+  }
+
+  return &cache.lru.front();
+}
+
+//
+// configure from the oboeInit() metricSeriesCache option which is either a
+// boolean or an object:
+//
+// options.capacity - most series cached (default 1000)
+//
+bool configure(Napi::Value v) {
+  if (v.IsBoolean()) {
+    enabled = v.As<Napi::Boolean>().Value();
+  } else if (v.IsObject() && !v.IsArray()) {
+    int64_t c = get_integer(v.As<Napi::Object>(), "capacity", 1000);
+    if (c < 1) {
+      return false;
+    }
+    capacity = c;
+    enabled = true;
+  } else {
+    return false;
+  }
+  generation += 1;
+  return true;
+}
+
+//
+// JavaScript callable
+//
+// getSeriesCacheStats(options)
+//
+// options.reset - reset the counts after reading them.
+// options.clear - empty the cache.
+//
+// returns {size, capacity, hits, misses, evictions}
+//
+Napi::Value getStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Cache& cache = get_cache(env);
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("size", Napi::Number::New(env, cache.lru.size()));
+  o.Set("capacity", Napi::Number::New(env, enabled ? capacity.load() : 0));
+  o.Set("hits", Napi::Number::New(env, cache.hits));
+  o.Set("misses", Napi::Number::New(env, cache.misses));
+  o.Set("evictions", Napi::Number::New(env, cache.evictions));
+
+  if (info.Length() == 1 && info[0].IsObject()) {
+    Napi::Object options = info[0].ToObject();
+    if (options.Get("reset").ToBoolean().Value()) {
+      cache.hits = 0;
+      cache.misses = 0;
+      cache.evictions = 0;
+    }
+    if (options.Get("clear").ToBoolean().Value()) {
+      cache.clear();
+    }
+  }
+
+  return o;
+}
+
+} // end namespace SeriesCache
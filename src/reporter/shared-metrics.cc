@@ -0,0 +1,542 @@
+#include "bindings.h"
+#include "reporter/reporter.h"
+#include "uv.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//
+// Custom metric aggregation shared by the processes on a host.
+//
+// When enabled, increments and summaries aren't passed to each process's
+// oboe. They are added to a table in a POSIX shared-memory segment that all
+// the processes using the same segment name write into. One process, the
+// leader, periodically sends the aggregated values to its oboe and zeroes
+// them. If the leader exits another process takes over at its next interval.
+//
+// The table is open addressed and lock-free. A slot is claimed by a
+// compare-and-swap of its hash and, once its key is written, marked ready;
+// after that only its count and sum change. Slots are never freed so the
+// number of slots limits the number of series. A metric that doesn't fit is
+// sent to the process's own oboe as before.
+//
+// A slot's key is the name, service and sorted tag keys and values stored
+// back to back with their lengths kept alongside, so they're compared and
+// sent exactly as they were recorded.
+//
+// Each process counts itself in the header while it's attached; the last
+// one to detach unlinks the segment. Attaching and detaching hold an
+// exclusive flock() on the segment so a process can't attach to a segment
+// that's being unlinked; one that finds its segment already unlinked opens
+// the name again. A process that dies without detaching leaves the segment
+// behind until it's removed from /dev/shm.
+//
+// Spans aren't aggregated; oboe derives their metrics internally.
+//
+namespace SharedMetrics {
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared metrics require lock-free 64 bit atomics");
+
+const uint32_t kMagic = 0x53574d31;  // "SWM1"
+const uint32_t kVersion = 2;
+const size_t kKeySize = 344;
+// a metric with more tags isn't shared.
+const size_t kMaxTags = 32;
+// the name, the service and the key and value of each tag.
+const size_t kMaxParts = 2 + 2 * kMaxTags;
+
+enum SlotState {
+  kEmpty = 0,
+  kReady = 1
+};
+
+struct Slot {
+  std::atomic<uint64_t> hash;
+  std::atomic<uint32_t> state;
+  uint16_t key_length;
+  uint8_t summary;
+  uint8_t host_tag;
+  uint8_t parts;
+  uint16_t lengths[kMaxParts];
+  char key[kKeySize];
+  std::atomic<int64_t> count;
+  // the bits of a double
+  std::atomic<uint64_t> sum;
+};
+
+struct Header {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint32_t slots;
+  uint32_t key_size;
+  std::atomic<int32_t> leader;
+  std::atomic<int32_t> attached;
+  std::atomic<uint64_t> dropped;
+};
+
+static bool enabled = false;
+static std::string segment_name;
+static size_t segment_size = 0;
+static Header* header = nullptr;
+// kept open while attached; it's what's locked.
+static int segment_fd = -1;
+static Slot* slots = nullptr;
+static uint32_t slot_mask = 0;
+static uint64_t interval_ms = 10 * 1000;
+
+// the timer runs on the loop of the environment that first configured
+// shared metrics; the segment is detached when that environment goes away.
+static uv_timer_t timer;
+static bool timer_initialized = false;
+static napi_env owner_env = nullptr;
+
+// reused to build keys.
+static std::string key;
+static std::vector<uint16_t> lengths;
+static std::vector<size_t> order;
+
+static void unmap() {
+  if (header) {
+    flock(segment_fd, LOCK_EX);
+    int32_t self = getpid();
+    header->leader.compare_exchange_strong(self, 0);
+    struct stat st;
+    if (header->attached.fetch_sub(1, std::memory_order_acq_rel) == 1
+        && fstat(segment_fd, &st) == 0 && st.st_nlink > 0) {
+      shm_unlink(segment_name.c_str());
+    }
+    munmap(header, segment_size);
+    // closing releases the lock.
+    close(segment_fd);
+  }
+  header = nullptr;
+  slots = nullptr;
+  segment_fd = -1;
+}
+
+enum AttachResult {
+  kAttached,
+  kFailed,
+  // the segment was unlinked by the last process to detach.
+  kUnlinked
+};
+
+//
+// create or open the segment. the process that creates it initializes the
+// header; others wait for the magic number that marks it ready.
+//
+static AttachResult attach(const std::string& name, uint32_t nslots) {
+  size_t size = sizeof(Header) + (size_t)nslots * sizeof(Slot);
+
+  bool created = true;
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0 && errno == EEXIST) {
+    created = false;
+    fd = shm_open(name.c_str(), O_RDWR, 0600);
+  }
+  if (fd < 0) {
+    return kFailed;
+  }
+
+  if (created) {
+    // the new pages are zeroed which is the empty state of every slot.
+    if (ftruncate(fd, size) != 0) {
+      close(fd);
+      shm_unlink(name.c_str());
+      return kFailed;
+    }
+  } else {
+    // wait briefly for the creator to size the segment.
+    struct stat st;
+    for (int i = 0; i < 1000; i++) {
+      if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(Header)) break;
+      usleep(1000);
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+      close(fd);
+      return kFailed;
+    }
+    size = st.st_size;
+  }
+
+  void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    close(fd);
+    return kFailed;
+  }
+  Header* h = static_cast<Header*>(p);
+
+  if (created) {
+    h->version = kVersion;
+    h->slots = nslots;
+    h->key_size = kKeySize;
+    h->magic.store(kMagic, std::memory_order_release);
+  } else {
+    for (int i = 0; i < 1000 && h->magic.load(std::memory_order_acquire) != kMagic; i++) {
+      usleep(1000);
+    }
+    // the layout is fixed by the creator; it must be one this code knows.
+    bool ok = h->magic.load(std::memory_order_acquire) == kMagic && h->version == kVersion
+      && h->key_size == kKeySize && h->slots && (h->slots & (h->slots - 1)) == 0
+      && sizeof(Header) + (size_t)h->slots * sizeof(Slot) <= size;
+    if (!ok) {
+      munmap(p, size);
+      close(fd);
+      return kFailed;
+    }
+    nslots = h->slots;
+  }
+
+  // count this process only if the segment is still linked; the last
+  // process to detach unlinks it while holding the lock.
+  struct stat st;
+  if (flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0) {
+    munmap(p, size);
+    close(fd);
+    return kFailed;
+  }
+  if (st.st_nlink == 0) {
+    munmap(p, size);
+    close(fd);
+    return kUnlinked;
+  }
+  h->attached.fetch_add(1, std::memory_order_acq_rel);
+  flock(fd, LOCK_UN);
+
+  header = h;
+  slots = reinterpret_cast<Slot*>(static_cast<char*>(p) + sizeof(Header));
+  slot_mask = nslots - 1;
+  segment_size = size;
+  segment_fd = fd;
+  return kAttached;
+}
+
+static bool map(const std::string& name, uint32_t nslots) {
+  for (int i = 0; i < 3; i++) {
+    AttachResult result = attach(name, nslots);
+    if (result != kUnlinked) {
+      return result == kAttached;
+    }
+  }
+  return false;
+}
+
+//
+// build the key of a series: its parts back to back and their lengths.
+// returns false if the series has too many tags or too long a key.
+//
+static bool build_key(const std::string& name, const std::string& service,
+                      const std::vector<std::string>& tag_keys, const std::vector<std::string>& tag_values) {
+  size_t tag_count = tag_keys.size();
+  if (tag_count > kMaxTags) {
+    return false;
+  }
+  order.resize(tag_count);
+  for (size_t i = 0; i < tag_count; i++) order[i] = i;
+  std::sort(order.begin(), order.end(), [&tag_keys](size_t a, size_t b) { return tag_keys[a] < tag_keys[b]; });
+
+  key.assign(name);
+  key += service;
+  lengths.assign({static_cast<uint16_t>(name.length()), static_cast<uint16_t>(service.length())});
+  for (size_t i : order) {
+    key += tag_keys[i];
+    key += tag_values[i];
+    lengths.push_back(tag_keys[i].length());
+    lengths.push_back(tag_values[i].length());
+  }
+  return key.length() <= kKeySize;
+}
+
+static bool same_key(const Slot& slot, bool summary, bool host_tag) {
+  return slot.summary == summary && slot.host_tag == host_tag && slot.parts == lengths.size()
+    && slot.key_length == key.length()
+    && memcmp(slot.lengths, lengths.data(), lengths.size() * sizeof(uint16_t)) == 0
+    && memcmp(slot.key, key.data(), key.length()) == 0;
+}
+
+//
+// add to a metric series. returns false if shared metrics are not enabled
+// or the series can't be added, so the caller should send the metric itself.
+//
+bool record(const std::string& name, const std::string& service,
+            const std::vector<std::string>& tag_keys, const std::vector<std::string>& tag_values,
+            bool host_tag, bool summary, double value, int64_t count) {
+  if (!enabled || !header) {
+    return false;
+  }
+  if (!build_key(name, service, tag_keys, tag_values)) {
+    header->dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  uint64_t h = fnv1a(key.data(), key.length());
+  h = fnv1a(reinterpret_cast<const char*>(lengths.data()), lengths.size() * sizeof(uint16_t), h);
+  h = mix64(h ^ (summary ? 's' : 'i') ^ (host_tag ? 0x100 : 0));
+  if (h == 0) h = 1;
+
+  for (uint32_t probe = 0; probe <= slot_mask; probe++) {
+    Slot& slot = slots[(h + probe) & slot_mask];
+    uint64_t current = slot.hash.load(std::memory_order_acquire);
+
+    if (current == 0) {
+      uint64_t expected = 0;
+      if (slot.hash.compare_exchange_strong(expected, h, std::memory_order_acq_rel)) {
+        memcpy(slot.key, key.data(), key.length());
+        memcpy(slot.lengths, lengths.data(), lengths.size() * sizeof(uint16_t));
+        slot.key_length = key.length();
+        slot.parts = lengths.size();
+        slot.summary = summary;
+        slot.host_tag = host_tag;
+        slot.state.store(kReady, std::memory_order_release);
+      }
+      current = slot.hash.load(std::memory_order_acquire);
+    }
+    if (current != h) {
+      continue;
+    }
+
+    // another process may be writing the key.
+    for (int i = 0; i < 1000 && slot.state.load(std::memory_order_acquire) != kReady; i++) {
+      sched_yield();
+    }
+    if (slot.state.load(std::memory_order_acquire) != kReady) {
+      break;
+    }
+    if (!same_key(slot, summary, host_tag)) {
+      continue;
+    }
+
+    slot.count.fetch_add(count, std::memory_order_relaxed);
+    if (summary) {
+      uint64_t old_bits = slot.sum.load(std::memory_order_relaxed);
+      uint64_t new_bits;
+      do {
+        double sum;
+        memcpy(&sum, &old_bits, sizeof(sum));
+        sum += value;
+        memcpy(&new_bits, &sum, sizeof(sum));
+      } while (!slot.sum.compare_exchange_weak(old_bits, new_bits, std::memory_order_relaxed));
+    }
+    return true;
+  }
+
+  header->dropped.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+//
+// is this process the leader? take over if the leader has gone away.
+//
+static bool lead() {
+  int32_t self = getpid();
+  int32_t leader = header->leader.load(std::memory_order_acquire);
+  if (leader == self) {
+    return true;
+  }
+  if (leader != 0 && (kill(leader, 0) == 0 || errno != ESRCH)) {
+    return false;
+  }
+  return header->leader.compare_exchange_strong(leader, self);
+}
+
+//
+// split a slot's key into its parts and send the series to oboe.
+//
+static void send_slot(Slot& slot, int64_t count, double sum) {
+  // the slot was written by a process that may not have been this code.
+  size_t total = 0;
+  for (size_t i = 0; i < slot.parts && i < kMaxParts; i++) total += slot.lengths[i];
+  if (slot.parts < 2 || slot.parts > kMaxParts || slot.parts % 2 || total != slot.key_length) {
+    return;
+  }
+
+  const char* p = slot.key;
+  std::string name(p, slot.lengths[0]);
+  p += slot.lengths[0];
+  std::string service(p, slot.lengths[1]);
+  p += slot.lengths[1];
+
+  size_t tag_count = (slot.parts - 2) / 2;
+  std::vector<std::string> parts(tag_count * 2);
+  std::vector<oboe_metric_tag_t> otags(tag_count);
+  for (size_t i = 0; i < tag_count * 2; i++) {
+    parts[i].assign(p, slot.lengths[i + 2]);
+    p += slot.lengths[i + 2];
+  }
+  for (size_t i = 0; i < tag_count; i++) {
+    otags[i].key = (char*)parts[i * 2].c_str();
+    otags[i].value = (char*)parts[i * 2 + 1].c_str();
+  }
+
+  if (slot.summary) {
+    oboe_custom_metric_summary(name.c_str(), sum, count, slot.host_tag, service.c_str(),
+                               otags.data(), tag_count);
+  } else {
+    oboe_custom_metric_increment(name.c_str(), count, slot.host_tag, service.c_str(),
+                                 otags.data(), tag_count);
+  }
+}
+
+//
+// if this process is the leader send every series with observations to
+// oboe and zero it. returns the number of series sent.
+//
+size_t flush() {
+  if (!header || !lead()) {
+    return 0;
+  }
+  size_t flushed = 0;
+  for (uint32_t i = 0; i <= slot_mask; i++) {
+    Slot& slot = slots[i];
+    if (slot.state.load(std::memory_order_acquire) != kReady) {
+      continue;
+    }
+    // the count and sum are taken separately so an observation being added
+    // may have its count and value reported in adjacent intervals.
+    int64_t count = slot.count.exchange(0, std::memory_order_relaxed);
+    if (count == 0) {
+      continue;
+    }
+    double sum = 0;
+    if (slot.summary) {
+      uint64_t bits = slot.sum.exchange(0, std::memory_order_relaxed);
+      memcpy(&sum, &bits, sizeof(sum));
+    }
+    send_slot(slot, count, sum);
+    flushed += 1;
+  }
+  return flushed;
+}
+
+static void timer_cb(uv_timer_t* handle) {
+  flush();
+}
+
+static void stop() {
+  if (timer_initialized) {
+    uv_timer_stop(&timer);
+  }
+  unmap();
+  enabled = false;
+}
+
+//
+// when the owning environment goes away send the last interval if this
+// process leads, then detach.
+//
+static void cleanup(void*) {
+  flush();
+  stop();
+  uv_close(reinterpret_cast<uv_handle_t*>(&timer), nullptr);
+  timer_initialized = false;
+  owner_env = nullptr;
+}
+
+//
+// configure from the oboeInit() sharedMetrics option which is either false
+// or an object:
+//
+// options.name - the shared-memory segment name, required. processes using
+//                the same name aggregate together so it must be unique to
+//                the service, e.g., include the service name and the pid of
+//                a cluster's primary.
+// options.slots - the most series, rounded up to a power of 2 (default 4096).
+//                 only used by the process that creates the segment.
+// options.interval - seconds between flushes by the leader, 0 to only flush
+//                    when flushSharedMetrics() is called (default 10)
+//
+bool configure(Napi::Value v) {
+  // the segment and timer belong to another thread.
+  if (owner_env && v.Env() != owner_env) {
+    return false;
+  }
+  if (v.IsBoolean() && !v.As<Napi::Boolean>().Value()) {
+    stop();
+    return true;
+  }
+  if (!v.IsObject() || v.IsArray()) {
+    return false;
+  }
+  Napi::Object o = v.As<Napi::Object>();
+
+  std::string name = get_string(o, "name", "");
+  int64_t nslots = get_integer(o, "slots", 4096);
+  int64_t interval = get_integer(o, "interval", 10);
+  if (name.empty() || name[0] != '/' || name.find('/', 1) != std::string::npos || name.length() > NAME_MAX
+      || nslots < 1 || nslots > (1 << 24) || interval < 0) {
+    return false;
+  }
+  uint32_t pow2 = 1;
+  while (pow2 < nslots) pow2 <<= 1;
+
+  stop();
+  if (!map(name, pow2)) {
+    return false;
+  }
+  segment_name = name;
+  interval_ms = interval * 1000;
+  enabled = true;
+
+  if (!owner_env) {
+    uv_loop_t* loop;
+    napi_get_uv_event_loop(v.Env(), &loop);
+    uv_timer_init(loop, &timer);
+    // don't keep the process alive just to flush metrics.
+    uv_unref(reinterpret_cast<uv_handle_t*>(&timer));
+    napi_add_env_cleanup_hook(v.Env(), cleanup, nullptr);
+    timer_initialized = true;
+    owner_env = v.Env();
+  }
+  if (interval_ms) {
+    uv_timer_start(&timer, timer_cb, interval_ms, interval_ms);
+  }
+  return true;
+}
+
+//
+// JavaScript callable
+//
+// flushSharedMetrics() flushes the shared series if this process is the
+// leader and returns the number of series sent.
+//
+Napi::Value flushSharedMetrics(const Napi::CallbackInfo& info) {
+  return Napi::Number::New(info.Env(), flush());
+}
+
+//
+// JavaScript callable
+//
+// getSharedMetricsStats() returns {name, slots, used, dropped, leader} or
+// undefined if shared metrics are not enabled. leader is the pid of the
+// process that flushes.
+//
+Napi::Value getStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (!enabled || !header) {
+    return env.Undefined();
+  }
+
+  uint32_t used = 0;
+  for (uint32_t i = 0; i <= slot_mask; i++) {
+    if (slots[i].hash.load(std::memory_order_relaxed)) used += 1;
+  }
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("name", Napi::String::New(env, segment_name));
+  o.Set("slots", Napi::Number::New(env, slot_mask + 1));
+  o.Set("used", Napi::Number::New(env, used));
+  o.Set("dropped", Napi::Number::New(env, header->dropped.load(std::memory_order_relaxed)));
+  o.Set("leader", Napi::Number::New(env, header->leader.load(std::memory_order_relaxed)));
+  return o;
+}
+
+} // end namespace SharedMetrics
@@ -0,0 +1,221 @@
+#include "bindings.h"
+#include "reporter/reporter.h"
+#include <unordered_map>
+#include <vector>
+
+//
+// Batch span submission. Many spans are handed to oboe in a single call
+// and the final transaction names are returned interned, so each distinct
+// name appears only once per batch.
+//
+// sendHttpSpans(spans) and sendNonHttpSpans(spans)
+//
+// spans is either an array of span objects, each the same as the argument
+// to sendHttpSpan(), or an object of columns:
+//
+// spans.strings - array of strings referenced by the string columns
+// spans.duration - Float64Array, required; its length is the number of spans
+// spans.status - Int32Array (optional)
+// spans.error - Uint8Array, non-zero for an error (optional)
+// spans.txname, spans.url, spans.domain, spans.method, spans.service,
+//   spans.exemplar - Int32Array of indexes into spans.strings, -1 for none
+//   (each optional). exemplar strings are trace ids or traceparents.
+//
+// returns {txnames: string[], indexes: Int32Array}. indexes[i] is the
+// index of span i's final transaction name in txnames or, if negative,
+// the error code oboe returned for the span.
+//
+
+//
+// collects the distinct final transaction names of a batch.
+//
+class TxnameInterner {
+ public:
+  explicit TxnameInterner(Napi::Env env) : env(env), names(Napi::Array::New(env)) {}
+
+  int32_t intern(const char* txname) {
+    auto it = index.find(txname);
+    if (it != index.end()) {
+      return it->second;
+    }
+    int32_t ix = names.Length();
+    index.emplace(txname, ix);
+    names[(uint32_t)ix] = TxnameCache::get(env, txname);
+    return ix;
+  }
+
+  Napi::Env env;
+  Napi::Array names;
+
+ private:
+  std::unordered_map<std::string, int32_t> index;
+};
+
+//
+// a string column is an Int32Array of indexes into the string table.
+//
+static const char* column_string(const std::vector<std::string>& table, Napi::Int32Array& column, size_t i) {
+  if (column.IsEmpty()) {
+    return "";
+  }
+  int32_t ix = column[i];
+  if (ix < 0 || (size_t)ix >= table.size()) {
+    return "";
+  }
+  return table[ix].c_str();
+}
+
+//
+// fetch an optional typed array column. returns false if the column is
+// present but is the wrong type or too short.
+//
+template <typename T>
+static bool get_column(Napi::Object o, const char* key, napi_typedarray_type type, size_t length, T& column) {
+  Napi::Value v = o.Get(key);
+  if (v.IsUndefined()) {
+    return true;
+  }
+  if (!v.IsTypedArray() || v.As<Napi::TypedArray>().TypedArrayType() != type) {
+    return false;
+  }
+  column = v.As<T>();
+  return column.ElementLength() >= length;
+}
+
+static Napi::Value send_span_rows(Napi::Env env, Napi::Array spans, send_generic_span_t send_function) {
+  uint32_t count = spans.Length();
+  TxnameInterner txnames(env);
+  Napi::Int32Array indexes = Napi::Int32Array::New(env, count);
+
+  // reused for every span.
+  oboe_span_params_t args;
+  SpanStrings strings;
+  char final_txname[OBOE_TRANSACTION_NAME_MAX_LENGTH + 1];
+
+  for (uint32_t i = 0; i < count; i++) {
+    Napi::Value span = spans[i];
+    if (!span.IsObject()) {
+      indexes[i] = OBOE_SPAN_NULL_PARAMS;
+      continue;
+    }
+    get_span_params(span.As<Napi::Object>(), strings, args);
+
+    int length = send_span_core(send_function, final_txname, sizeof(final_txname), &args,
+                                strings.trace_id.c_str());
+    indexes[i] = length < 0 ? length : txnames.intern(final_txname);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("txnames", txnames.names);
+  result.Set("indexes", indexes);
+  return result;
+}
+
+static Napi::Value send_span_columns(Napi::Env env, Napi::Object spans, send_generic_span_t send_function) {
+  Napi::Value d = spans.Get("duration");
+  if (!d.IsTypedArray() || d.As<Napi::TypedArray>().TypedArrayType() != napi_float64_array) {
+    Napi::TypeError::New(env, "sendXSpans() - duration must be a Float64Array").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  Napi::Float64Array duration = d.As<Napi::Float64Array>();
+  size_t count = duration.ElementLength();
+
+  Napi::Int32Array status;
+  Napi::Uint8Array error;
+  Napi::Int32Array txname;
+  Napi::Int32Array url;
+  Napi::Int32Array domain;
+  Napi::Int32Array method;
+  Napi::Int32Array service;
+  Napi::Int32Array exemplar;
+
+  bool ok = get_column(spans, "status", napi_int32_array, count, status)
+    && get_column(spans, "error", napi_uint8_array, count, error)
+    && get_column(spans, "txname", napi_int32_array, count, txname)
+    && get_column(spans, "url", napi_int32_array, count, url)
+    && get_column(spans, "domain", napi_int32_array, count, domain)
+    && get_column(spans, "method", napi_int32_array, count, method)
+    && get_column(spans, "service", napi_int32_array, count, service)
+    && get_column(spans, "exemplar", napi_int32_array, count, exemplar);
+  if (!ok) {
+    Napi::TypeError::New(env, "sendXSpans() - invalid column").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // convert the string table once for the whole batch.
+  std::vector<std::string> table;
+  Napi::Value s = spans.Get("strings");
+  if (s.IsArray()) {
+    Napi::Array strings = s.As<Napi::Array>();
+    table.reserve(strings.Length());
+    for (uint32_t i = 0; i < strings.Length(); i++) {
+      Napi::Value v = strings[i];
+      table.push_back(v.IsString() ? v.As<Napi::String>().Utf8Value() : "");
+    }
+  }
+
+  // the exemplar column refers to trace ids in the string table; parse
+  // them once. entries that aren't sampled trace ids become empty.
+  std::vector<std::string> trace_ids;
+  if (!exemplar.IsEmpty()) {
+    trace_ids.resize(table.size());
+    for (size_t i = 0; i < table.size(); i++) {
+      Exemplars::parse(table[i], trace_ids[i]);
+    }
+  }
+
+  TxnameInterner txnames(env);
+  Napi::Int32Array indexes = Napi::Int32Array::New(env, count);
+
+  oboe_span_params_t args;
+  char final_txname[OBOE_TRANSACTION_NAME_MAX_LENGTH + 1];
+
+  for (size_t i = 0; i < count; i++) {
+    args.version = 1;
+    args.duration = duration[i];
+    args.status = status.IsEmpty() ? 0 : status[i];
+    args.has_error = error.IsEmpty() ? 0 : error[i] != 0;
+    args.transaction = column_string(table, txname, i);
+    args.url = column_string(table, url, i);
+    args.domain = column_string(table, domain, i);
+    args.method = column_string(table, method, i);
+    args.service = column_string(table, service, i);
+
+    int length = send_span_core(send_function, final_txname, sizeof(final_txname), &args,
+                                column_string(trace_ids, exemplar, i));
+    indexes[i] = length < 0 ? length : txnames.intern(final_txname);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("txnames", txnames.names);
+  result.Set("indexes", indexes);
+  return result;
+}
+
+static Napi::Value send_spans(const Napi::CallbackInfo& info, send_generic_span_t send_function) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() != 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "sendXSpans() - requires Array or Object parameter").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (info[0].IsArray()) {
+    return send_span_rows(env, info[0].As<Napi::Array>(), send_function);
+  }
+  return send_span_columns(env, info[0].As<Napi::Object>(), send_function);
+}
+
+//
+// send a batch of spans using oboe_http_span
+//
+Napi::Value sendHttpSpans(const Napi::CallbackInfo& info) {
+  return send_spans(info, oboe_http_span);
+}
+
+//
+// send a batch of spans using oboe_span
+//
+Napi::Value sendNonHttpSpans(const Napi::CallbackInfo& info) {
+  return send_spans(info, oboe_span);
+}
@@ -0,0 +1,212 @@
+#include "bindings.h"
+#include "reporter/reporter.h"
+#include "metrics/hdr_histogram.h"
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+//
+// Local latency distributions of the spans sent to oboe. There is one
+// histogram for all spans and one for each final transaction name, up to
+// a configurable number of transactions. Durations are in microseconds.
+//
+// Spans are sent from every thread so the histograms are guarded by a mutex.
+//
+namespace SpanHistograms {
+
+// the largest duration recorded is an hour; longer spans are recorded as
+// an hour. two significant figures keeps each histogram at about 25KB.
+const int64_t kHighestTrackable = INT64_C(3600000000);
+const int kSignificantFigures = 2;
+
+struct SpanHistogram {
+  struct hdr_histogram* hist = nullptr;
+  uint64_t errors = 0;
+  Exemplars::Reservoir exemplars;
+};
+
+static std::map<std::string, double> PERCENTILES = {
+  {"p50", 50.0}, {"p75", 75.0}, {"p90", 90.0}, {"p95", 95.0}, {"p99", 99.0}
+};
+
+std::atomic<bool> enabled(false);
+
+static std::mutex mutex;
+static size_t max_transactions = OBOE_DEFAULT_MAX_TRANSACTIONS;
+
+static SpanHistogram all;
+static std::unordered_map<std::string, SpanHistogram> transactions;
+
+// spans whose transaction wasn't tracked because the limit was reached.
+static uint64_t untracked = 0;
+
+// reused for lookups so short-lived keys don't need an allocation.
+static std::string key;
+
+static bool record_in(SpanHistogram& h, int64_t duration, bool error, const char* trace_id) {
+  if (!h.hist && hdr_init(1, kHighestTrackable, kSignificantFigures, &h.hist) != 0) {
+    h.hist = nullptr;
+    return false;
+  }
+  if (duration < 1) {
+    duration = 1;
+  } else if (duration > kHighestTrackable) {
+    duration = kHighestTrackable;
+  }
+  hdr_record_value(h.hist, duration);
+  if (error) {
+    h.errors += 1;
+  }
+  if (*trace_id) {
+    h.exemplars.offer(trace_id, duration);
+  }
+  return true;
+}
+
+static void reset() {
+  for (auto& entry : transactions) {
+    hdr_close(entry.second.hist);
+  }
+  transactions.clear();
+  if (all.hist) {
+    hdr_reset(all.hist);
+  }
+  all.errors = 0;
+  all.exemplars.clear();
+  untracked = 0;
+}
+
+//
+// record a span. txname is null if oboe didn't return a final transaction
+// name; the span is then only recorded in the histogram of all spans.
+// trace_id is the span's exemplar or empty.
+//
+void record(const char* txname, int64_t duration, bool error, const char* trace_id) {
+  if (!enabled) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  record_in(all, duration, error, trace_id);
+
+  if (!txname) {
+    return;
+  }
+  key.assign(txname);
+  auto it = transactions.find(key);
+  if (it == transactions.end()) {
+    if (transactions.size() >= max_transactions) {
+      untracked += 1;
+      return;
+    }
+    it = transactions.emplace(key, SpanHistogram()).first;
+  }
+  record_in(it->second, duration, error, trace_id);
+}
+
+//
+// configure from the oboeInit() spanHistograms option which is either a
+// boolean or an object:
+//
+// options.maxTransactions - most transactions tracked individually
+//
+bool configure(Napi::Value v) {
+  bool e = true;
+  int64_t max = -1;
+  if (v.IsBoolean()) {
+    e = v.As<Napi::Boolean>().Value();
+  } else if (v.IsObject() && !v.IsArray()) {
+    max = get_integer(v.As<Napi::Object>(), "maxTransactions", OBOE_DEFAULT_MAX_TRANSACTIONS);
+    if (max < 0) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (max >= 0) {
+    max_transactions = max;
+  }
+  enabled = e;
+  reset();
+  return true;
+}
+
+static Napi::Object histogram_values(Napi::Env env, const SpanHistogram& h) {
+  Napi::Object o = Napi::Object::New(env);
+
+  int64_t count = h.hist ? h.hist->total_count : 0;
+  double mean = 0;
+  double stddev = 0;
+  int64_t min = 0;
+  int64_t max = 0;
+
+  if (count) {
+    min = hdr_min(h.hist);
+    max = hdr_max(h.hist);
+    mean = hdr_mean(h.hist);
+    stddev = hdr_stddev(h.hist);
+  }
+
+  o.Set("count", Napi::Number::New(env, count));
+  o.Set("errors", Napi::Number::New(env, h.errors));
+
+  std::map<std::string, double>::iterator it;
+  for (it = PERCENTILES.begin(); it != PERCENTILES.end(); it++) {
+    const int64_t p = count ? hdr_value_at_percentile(h.hist, it->second) : 0;
+    o.Set(it->first, Napi::Number::New(env, p));
+  }
+
+  o.Set("min", Napi::Number::New(env, min));
+  o.Set("max", Napi::Number::New(env, max));
+  o.Set("mean", Napi::Number::New(env, mean));
+  o.Set("stddev", Napi::Number::New(env, stddev));
+  o.Set("exemplars", h.exemplars.toValue(env));
+
+  return o;
+}
+
+//
+// JavaScript callable
+//
+// getSpanHistograms(options)
+//
+// options.reset - start a new interval after reading the histograms.
+//
+// returns {all, transactions: {txname: histogram}, untracked} where each
+// histogram is {count, errors, p50, p75, p90, p95, p99, min, max, mean, stddev,
+// exemplars}. exemplars is null or {max, latest}, each {traceId, value,
+// timestamp}, from spans sent with an exemplar.
+// returns undefined if span histograms are not enabled.
+//
+Napi::Value get(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (!enabled) {
+    return env.Undefined();
+  }
+
+  bool do_reset = false;
+  if (info.Length() == 1 && info[0].IsObject()) {
+    do_reset = info[0].ToObject().Get("reset").ToBoolean().Value();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Napi::Object txs = Napi::Object::New(env);
+  for (auto& entry : transactions) {
+    txs.Set(entry.first, histogram_values(env, entry.second));
+  }
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("all", histogram_values(env, all));
+  o.Set("transactions", txs);
+  o.Set("untracked", Napi::Number::New(env, untracked));
+
+  if (do_reset) {
+    reset();
+  }
+
+  return o;
+}
+
+} // end namespace SpanHistograms
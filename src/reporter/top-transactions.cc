@@ -0,0 +1,214 @@
+#include "bindings.h"
+#include "reporter/reporter.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+//
+// Approximate top-K transactions by span count using the space-saving
+// algorithm. A fixed number of counters is kept; a transaction that isn't
+// counted replaces the one with the smallest count and inherits that count
+// as its error. Any transaction whose true count is more than the total
+// number of spans divided by the capacity is guaranteed to be counted.
+//
+// The counters are kept in a binary min-heap so the smallest is found in
+// constant time and an increment costs at most log(capacity).
+//
+// Spans are sent from every thread so the counters are guarded by a mutex.
+//
+namespace TopTransactions {
+
+struct Counter {
+  std::string name;
+  uint64_t count;
+  // count's possible overestimate
+  uint64_t error;
+  // total duration of the spans counted, in microseconds
+  uint64_t duration;
+};
+
+static std::atomic<bool> enabled(false);
+
+static std::mutex mutex;
+static size_t capacity = 100;
+
+static std::vector<Counter> heap;
+static std::unordered_map<std::string, size_t> positions;
+
+// reused for lookups so short-lived keys don't need an allocation.
+static std::string key;
+
+static void swap_entries(size_t a, size_t b) {
+  std::swap(heap[a], heap[b]);
+  positions[heap[a].name] = a;
+  positions[heap[b].name] = b;
+}
+
+//
+// restore the heap after heap[i]'s count was increased.
+//
+static void sift_down(size_t i) {
+  size_t n = heap.size();
+  while (true) {
+    size_t smallest = i;
+    size_t l = 2 * i + 1;
+    size_t r = l + 1;
+    if (l < n && heap[l].count < heap[smallest].count) smallest = l;
+    if (r < n && heap[r].count < heap[smallest].count) smallest = r;
+    if (smallest == i) {
+      return;
+    }
+    swap_entries(i, smallest);
+    i = smallest;
+  }
+}
+
+static void sift_up(size_t i) {
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (heap[parent].count <= heap[i].count) {
+      return;
+    }
+    swap_entries(i, parent);
+    i = parent;
+  }
+}
+
+//
+// count a span for the final transaction name.
+//
+void record(const char* txname, int64_t duration) {
+  if (!enabled || !txname) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  if (capacity == 0) {
+    return;
+  }
+  uint64_t d = duration > 0 ? duration : 0;
+
+  key.assign(txname);
+  auto it = positions.find(key);
+  if (it != positions.end()) {
+    Counter& c = heap[it->second];
+    c.count += 1;
+    c.duration += d;
+    sift_down(it->second);
+    return;
+  }
+
+  if (heap.size() < capacity) {
+    heap.push_back({key, 1, 0, d});
+    positions[key] = heap.size() - 1;
+    sift_up(heap.size() - 1);
+    return;
+  }
+
+  // replace the smallest counter.
+  Counter& min = heap[0];
+  positions.erase(min.name);
+  min.error = min.count;
+  min.count += 1;
+  min.name = key;
+  min.duration = d;
+  positions[key] = 0;
+  sift_down(0);
+}
+
+static void reset() {
+  heap.clear();
+  positions.clear();
+}
+
+//
+// configure from the oboeInit() topTransactions option which is either a
+// boolean or an object:
+//
+// options.capacity - number of counters kept (default 100). the larger it
+//                    is the more accurate the counts.
+//
+bool configure(Napi::Value v) {
+  bool e = true;
+  int64_t c = 0;
+  if (v.IsBoolean()) {
+    e = v.As<Napi::Boolean>().Value();
+  } else if (v.IsObject() && !v.IsArray()) {
+    c = get_integer(v.As<Napi::Object>(), "capacity", 100);
+    if (c < 1) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (c) {
+    capacity = c;
+  }
+  enabled = e;
+  reset();
+  heap.reserve(capacity);
+  return true;
+}
+
+//
+// JavaScript callable
+//
+// getTopTransactions(k, options)
+//
+// k - the number of transactions to return (default all that are counted)
+// options.reset - clear the counters after reading them.
+//
+// returns an array of {name, count, error, duration} sorted by descending
+// count. count may be overestimated by up to error. duration is the total of
+// the counted spans' durations in microseconds. returns undefined if top
+// transactions are not enabled.
+//
+Napi::Value get(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (!enabled) {
+    return env.Undefined();
+  }
+
+  bool have_k = info.Length() >= 1 && info[0].IsNumber();
+  int64_t n = have_k ? info[0].As<Napi::Number>().Int64Value() : 0;
+  bool do_reset = false;
+  if (info.Length() >= 2 && info[1].IsObject()) {
+    do_reset = info[1].ToObject().Get("reset").ToBoolean().Value();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t k = heap.size();
+  if (have_k) {
+    k = n < 0 ? 0 : std::min(k, (size_t)n);
+  }
+
+  std::vector<const Counter*> sorted;
+  sorted.reserve(heap.size());
+  for (const Counter& c : heap) {
+    sorted.push_back(&c);
+  }
+  std::partial_sort(sorted.begin(), sorted.begin() + k, sorted.end(),
+                    [](const Counter* a, const Counter* b) { return a->count > b->count; });
+
+  Napi::Array a = Napi::Array::New(env, k);
+  for (size_t i = 0; i < k; i++) {
+    Napi::Object o = Napi::Object::New(env);
+    o.Set("name", Napi::String::New(env, sorted[i]->name));
+    o.Set("count", Napi::Number::New(env, sorted[i]->count));
+    o.Set("error", Napi::Number::New(env, sorted[i]->error));
+    o.Set("duration", Napi::Number::New(env, sorted[i]->duration));
+    a.Set(static_cast<uint32_t>(i), o);
+  }
+
+  if (do_reset) {
+    reset();
+  }
+
+  return a;
+}
+
+} // end namespace TopTransactions
@@ -0,0 +1,137 @@
+#include "bindings.h"
+#include "reporter/reporter.h"
+#include <atomic>
+#include <unordered_map>
+
+//
+// Cache of final transaction names returned by oboe. The number of distinct
+// names is bounded by oboe's maxTransactions so each one is converted to a
+// JavaScript string once and the same string is returned thereafter. Each
+// environment that loads the addon has its own cache.
+//
+namespace TxnameCache {
+
+//
+// each environment has its own cache because a reference is only valid in
+// the environment that created it. strings are primitives and can't be
+// referenced directly on older napi versions, so they're kept in an array
+// held by the environment's instance data and the map holds their indexes.
+//
+struct Cache {
+  std::unordered_map<std::string, uint32_t> names;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  // reused for lookups so short-lived keys don't need an allocation.
+  std::string key;
+};
+
+// set by oboeInit() and shared by all environments.
+static std::atomic<size_t> capacity(OBOE_DEFAULT_MAX_TRANSACTIONS);
+
+static Cache& get_cache(Napi::Env env, InstanceData* data) {
+  if (!data->txnames) {
+    data->txnames = new Cache;
+  }
+  if (data->txname_strings.IsEmpty()) {
+    data->txname_strings = Napi::Persistent(Napi::Array::New(env).As<Napi::Object>());
+  }
+  return *data->txnames;
+}
+
+//
+// drop all cached strings.
+//
+static void clear(Napi::Env env, InstanceData* data) {
+  data->txnames->names.clear();
+  data->txname_strings.Reset(Napi::Array::New(env), 1);
+}
+
+//
+// return the JavaScript string for a transaction name, creating and caching
+// it if it isn't already present. when the cache is full new names are
+// returned without being cached.
+//
+Napi::String get(Napi::Env env, const char* txname) {
+  InstanceData* data = instance_data(env);
+  Cache& cache = get_cache(env, data);
+  cache.key.assign(txname);
+
+  auto it = cache.names.find(cache.key);
+  if (it != cache.names.end()) {
+    cache.hits += 1;
+    return data->txname_strings.Value().Get(it->second).As<Napi::String>();
+  }
+
+  cache.misses += 1;
+  Napi::String s = Napi::String::New(env, txname);
+  size_t max = capacity.load(std::memory_order_relaxed);
+  // the capacity may have been lowered since the cache was filled.
+  if (cache.names.size() > max) {
+    clear(env, data);
+  }
+  if (cache.names.size() < max) {
+    uint32_t ix = cache.names.size();
+    data->txname_strings.Value().Set(ix, s);
+    cache.names.emplace(cache.key, ix);
+  }
+  return s;
+}
+
+//
+// called when the environment's instance data is deleted.
+//
+void destroy(Cache* cache) {
+  delete cache;
+}
+
+//
+// set the maximum number of names cached. a cache that's already larger
+// than the new capacity is emptied the next time a name is added.
+//
+void setCapacity(size_t n) {
+  capacity.store(n, std::memory_order_relaxed);
+}
+
+//
+// JavaScript callable
+//
+// getTxnameCacheStats(options)
+//
+// options.reset - reset the hit and miss counts after reading them.
+// options.clear - empty the cache after reading the stats.
+//
+Napi::Value getStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  bool reset = false;
+  bool empty = false;
+  if (info.Length() == 1 && info[0].IsObject()) {
+    Napi::Object o = info[0].ToObject();
+    reset = o.Get("reset").ToBoolean().Value();
+    empty = o.Get("clear").ToBoolean().Value();
+  }
+
+  InstanceData* data = instance_data(env);
+  Cache& cache = get_cache(env, data);
+  uint64_t lookups = cache.hits + cache.misses;
+  double ratio = lookups ? (double)cache.hits / lookups : 0;
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("size", Napi::Number::New(env, cache.names.size()));
+  o.Set("capacity", Napi::Number::New(env, capacity.load(std::memory_order_relaxed)));
+  o.Set("hits", Napi::Number::New(env, cache.hits));
+  o.Set("misses", Napi::Number::New(env, cache.misses));
+  o.Set("hitRatio", Napi::Number::New(env, ratio));
+
+  if (reset) {
+    cache.hits = 0;
+    cache.misses = 0;
+  }
+  if (empty) {
+    clear(env, data);
+  }
+
+  return o;
+}
+
+} // end namespace TxnameCache
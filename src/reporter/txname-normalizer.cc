@@ -0,0 +1,342 @@
+#include "bindings.h"
+#include "reporter/reporter.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+//
+// Normalizes the url of an HTTP span that has no transaction name so that
+// oboe derives a bounded set of transaction names from it. A url is first
+// matched against the configured path templates; if none matches, path
+// segments that look like identifiers are replaced by placeholders:
+//
+// numeric        /orders/12345          => /orders/:id
+// uuid           /users/1b4e28ba-2fa1-11d2-883f-0016d3cca427 => /users/:uuid
+// hex            /blobs/5d41402abc4b2a76b9719d911017c592 => /blobs/:hex
+//
+// Templates are paths whose segments are literals, ":name" to match any
+// single segment, or a final "*" to match the remaining segments, e.g.,
+// "/api/users/:id/orders" or "/static/*". A url that matches a template is
+// replaced by the template.
+//
+// Query strings and fragments are always removed. A url with more than
+// maxSegments segments keeps the first maxSegments followed by "/*" so it
+// doesn't collide with the shorter url, and only matches templates ending
+// in "*".
+//
+// The configuration is immutable once built and shared by all threads.
+//
+namespace TxnameNormalizer {
+
+// most segments examined in a url.
+const size_t kMaxSegments = 32;
+
+// hex segments shorter than this are left alone so words like "cafe" or
+// "added" are not replaced.
+const size_t kDefaultHexMinLength = 16;
+
+struct Segment {
+  const char* p;
+  size_t len;
+};
+
+//
+// a node in the template trie.
+//
+struct Node {
+  std::vector<std::pair<std::string, int>> literals;  // segment => child node
+  int param = -1;       // child node for a ":name" segment
+  int rest = -1;        // template index for a final "*"
+  int terminal = -1;    // template index of the template ending here
+};
+
+struct Config {
+  bool enabled = false;
+  bool detect_numeric = true;
+  bool detect_uuid = true;
+  bool detect_hex = true;
+  size_t hex_min_length = kDefaultHexMinLength;
+  size_t max_segments = kMaxSegments;
+
+  // node 0 is the root.
+  std::vector<Node> trie = std::vector<Node>(1);
+  std::vector<std::string> templates;
+};
+
+// read and replaced with std::atomic_load() and std::atomic_store().
+static std::shared_ptr<const Config> config = std::make_shared<Config>();
+
+//
+// character classes used by the detectors.
+//
+enum {
+  kDigit = 1 << 0,
+  kHex = 1 << 1
+};
+
+// filled in when the addon is loaded, before any thread can use it.
+static const struct CharClass {
+  uint8_t c[256] = {};
+
+  CharClass() {
+    for (int i = '0'; i <= '9'; i++) c[i] = kDigit | kHex;
+    for (int i = 'a'; i <= 'f'; i++) c[i] = kHex;
+    for (int i = 'A'; i <= 'F'; i++) c[i] = kHex;
+  }
+  uint8_t operator[](uint8_t i) const { return c[i]; }
+} char_class;
+
+static bool is_numeric(const Segment& s) {
+  for (size_t i = 0; i < s.len; i++) {
+    if (!(char_class[(uint8_t)s.p[i]] & kDigit)) return false;
+  }
+  return true;
+}
+
+// 8-4-4-4-12
+static bool is_uuid(const Segment& s) {
+  if (s.len != 36) return false;
+  for (size_t i = 0; i < s.len; i++) {
+    if (i == 8 || i == 13 || i == 18 || i == 23) {
+      if (s.p[i] != '-') return false;
+    } else if (!(char_class[(uint8_t)s.p[i]] & kHex)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool is_hex(const Segment& s, size_t hex_min_length) {
+  if (s.len < hex_min_length) return false;
+  for (size_t i = 0; i < s.len; i++) {
+    if (!(char_class[(uint8_t)s.p[i]] & kHex)) return false;
+  }
+  return true;
+}
+
+//
+// split a path into segments, ignoring empty segments and anything after
+// a '?' or '#'. returns the number of segments found, at most max. truncated,
+// if not null, is set if there were more.
+//
+static size_t split(const char* path, Segment* segments, size_t max, bool* trailing_slash,
+                    bool* truncated = nullptr) {
+  size_t n = 0;
+  const char* p = path;
+  *trailing_slash = false;
+
+  while (*p && *p != '?' && *p != '#') {
+    if (*p == '/') {
+      p++;
+      continue;
+    }
+    if (n == max) {
+      if (truncated) {
+        *truncated = true;
+      }
+      break;
+    }
+    const char* start = p;
+    while (*p && *p != '/' && *p != '?' && *p != '#') p++;
+    segments[n++] = {start, (size_t)(p - start)};
+    *trailing_slash = *p == '/' && (p[1] == '\0' || p[1] == '?' || p[1] == '#');
+  }
+  return n;
+}
+
+//
+// add a template to a trie. returns false if it's not a valid template.
+//
+static bool add_template(std::vector<Node>& nodes, std::vector<std::string>& names, const std::string& t) {
+  Segment segments[kMaxSegments];
+  bool trailing_slash;
+  if (t.empty() || t[0] != '/') {
+    return false;
+  }
+  size_t n = split(t.c_str(), segments, kMaxSegments, &trailing_slash);
+
+  int ix = names.size();
+  int node = 0;
+  for (size_t i = 0; i < n; i++) {
+    const Segment& s = segments[i];
+    if (s.len == 1 && s.p[0] == '*') {
+      // "*" must be the last segment.
+      if (i != n - 1) {
+        return false;
+      }
+      nodes[node].rest = ix;
+      names.push_back(t);
+      return true;
+    }
+
+    int next = -1;
+    if (s.p[0] == ':') {
+      next = nodes[node].param;
+      if (next < 0) {
+        next = nodes.size();
+        nodes.emplace_back();
+        nodes[node].param = next;
+      }
+    } else {
+      for (auto& literal : nodes[node].literals) {
+        if (literal.first.size() == s.len && !memcmp(literal.first.data(), s.p, s.len)) {
+          next = literal.second;
+          break;
+        }
+      }
+      if (next < 0) {
+        next = nodes.size();
+        nodes.emplace_back();
+        nodes[node].literals.emplace_back(std::string(s.p, s.len), next);
+      }
+    }
+    node = next;
+  }
+  nodes[node].terminal = ix;
+  names.push_back(t);
+  return true;
+}
+
+//
+// find the template matching the segments. literals take precedence over
+// ":name" segments which take precedence over "*". if the segments were
+// truncated only a "*" can match what's missing.
+//
+static int match(const std::vector<Node>& trie, int node, const Segment* segments, size_t n,
+                 bool truncated) {
+  const Node& nd = trie[node];
+  if (n == 0) {
+    return nd.terminal >= 0 && !truncated ? nd.terminal : nd.rest;
+  }
+  for (auto& literal : nd.literals) {
+    if (literal.first.size() == segments->len && !memcmp(literal.first.data(), segments->p, segments->len)) {
+      int t = match(trie, literal.second, segments + 1, n - 1, truncated);
+      if (t >= 0) return t;
+      break;
+    }
+  }
+  if (nd.param >= 0) {
+    int t = match(trie, nd.param, segments + 1, n - 1, truncated);
+    if (t >= 0) return t;
+  }
+  return nd.rest;
+}
+
+//
+// normalize url into buffer. returns false if the normalizer is not enabled.
+//
+bool normalize(const char* url, char* buffer, size_t size) {
+  std::shared_ptr<const Config> c = std::atomic_load(&config);
+  if (!c->enabled || size == 0) {
+    return false;
+  }
+
+  Segment segments[kMaxSegments];
+  bool trailing_slash;
+  bool truncated = false;
+  size_t n = split(url, segments, c->max_segments, &trailing_slash, &truncated);
+
+  if (c->templates.size()) {
+    int t = match(c->trie, 0, segments, n, truncated);
+    if (t >= 0) {
+      strncpy(buffer, c->templates[t].c_str(), size - 1);
+      buffer[size - 1] = '\0';
+      return true;
+    }
+  }
+
+  char* b = buffer;
+  char* end = buffer + size - 1;
+
+  auto put = [&b, end](const char* p, size_t len) {
+    size_t room = end - b;
+    if (len > room) len = room;
+    memcpy(b, p, len);
+    b += len;
+  };
+
+  for (size_t i = 0; i < n; i++) {
+    const Segment& s = segments[i];
+    put("/", 1);
+    if (c->detect_numeric && is_numeric(s)) {
+      put(":id", 3);
+    } else if (c->detect_uuid && is_uuid(s)) {
+      put(":uuid", 5);
+    } else if (c->detect_hex && is_hex(s, c->hex_min_length)) {
+      put(":hex", 4);
+    } else {
+      put(s.p, s.len);
+    }
+  }
+  if (truncated) {
+    put("/*", 2);
+  } else if (n == 0 || trailing_slash) {
+    put("/", 1);
+  }
+  *b = '\0';
+
+  return true;
+}
+
+//
+// configure the normalizer. called by oboeInit() with the value of the
+// txnameNormalizer option which is either a boolean or an object:
+//
+// options.templates - array of template strings
+// options.numeric - replace numeric segments (default true)
+// options.uuid - replace uuid segments (default true)
+// options.hex - replace hex segments (default true)
+// options.hexMinLength - minimum length of a hex segment (default 16)
+// options.maxSegments - segments after this are dropped (default 32)
+//
+// returns false, leaving the previous configuration unchanged, if the value
+// is not valid.
+//
+bool configure(Napi::Value v) {
+  std::shared_ptr<Config> c = std::make_shared<Config>();
+  if (v.IsBoolean()) {
+    c->enabled = v.As<Napi::Boolean>().Value();
+    std::atomic_store(&config, std::shared_ptr<const Config>(std::move(c)));
+    return true;
+  }
+  if (!v.IsObject() || v.IsArray()) {
+    return false;
+  }
+  Napi::Object o = v.As<Napi::Object>();
+
+  std::vector<std::string> strings;
+  if (o.Has("templates")) {
+    Napi::Value t = o.Get("templates");
+    if (!t.IsArray()) {
+      return false;
+    }
+    Napi::Array a = t.As<Napi::Array>();
+    for (uint32_t i = 0; i < a.Length(); i++) {
+      Napi::Value s = a[i];
+      if (!s.IsString()) {
+        return false;
+      }
+      strings.push_back(s.As<Napi::String>());
+    }
+  }
+
+  for (auto& s : strings) {
+    if (!add_template(c->trie, c->templates, s)) {
+      return false;
+    }
+  }
+
+  c->detect_numeric = get_boolean(o, "numeric", true);
+  c->detect_uuid = get_boolean(o, "uuid", true);
+  c->detect_hex = get_boolean(o, "hex", true);
+  int64_t hex_min = get_integer(o, "hexMinLength", kDefaultHexMinLength);
+  c->hex_min_length = hex_min < 1 ? 1 : hex_min;
+  int64_t max = get_integer(o, "maxSegments", kMaxSegments);
+  c->max_segments = max < 0 || max > (int64_t)kMaxSegments ? kMaxSegments : max;
+  c->enabled = true;
+
+  std::atomic_store(&config, std::shared_ptr<const Config>(std::move(c)));
+  return true;
+}
+
+} // end namespace TxnameNormalizer
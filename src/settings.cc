@@ -1,5 +1,8 @@
 #include "bindings.h"
+#include "settings/settings.h"
+#include "uv.h"
 #include <cmath>
+#include <cstring>
 
 //
 // Set the tracing mode.
@@ -74,35 +77,80 @@ Napi::Value setDefaultSampleRate(const Napi::CallbackInfo& info) {
 //                                     request level customized mode/rates.
 
 //
-// New function to start a trace. It returns all information
-// necessary in a single call.
-//
-// getTraceSettings(object)
-//
-// object.xtrace - Metadata instance or undefined
-// object.mode - a route-specific trace mode, 0 or 1 for 'never'
-// or 'always' object.rate - a route-specific sampling rate
-// object.edge - override the default edge setting.
+// the inputs, outputs and resulting metadata of a tracing decision. the
+// strings are kept here so they outlive the call to oboe.
 //
-Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
-
+struct TraceDecision {
   oboe_tracing_decisions_in_t in;
   oboe_tracing_decisions_out_t out;
   oboe_metadata_t omd;
 
-  // in defaults
-  bool have_metadata = false;
-  std::string xtrace;
+  // the xtrace is read into a fixed buffer because anything longer than
+  // 60 characters isn't valid anyway.
+  char xtrace[64];
+  size_t xtrace_len = 0;
   std::string tracestate;
-  int rate = -1;
-  int mode = -1;
+  std::string xtraceOpts;
+  std::string xtraceOptsSig;
+
+  int status;
+  bool have_metadata = false;
   // edge back to supplied metadata unless there is none.
   bool edge = true;
+};
 
-  // debugging booleans
-  //bool showIn = false;
-  //bool showOut = false;
+//
+// read an xtrace, which can be a string or the bytes of the header in a
+// Buffer or Uint8Array, and convert it to metadata. if it isn't valid act
+// as if no xtrace was supplied.
+//
+static void read_xtrace(Napi::Env env, Napi::Value v, TraceDecision& d) {
+  const char* bytes;
+  size_t length;
+  if (TraceContext::getBytes(v, bytes, length)) {
+    // anything that doesn't fit isn't valid.
+    d.xtrace_len = length < sizeof(d.xtrace) ? length : 0;
+    memcpy(d.xtrace, bytes, d.xtrace_len);
+    d.xtrace[d.xtrace_len] = '\0';
+  } else if (v.IsString()) {
+    // napi truncates without saying so; a string that doesn't fit isn't
+    // valid even if its first bytes are.
+    size_t length = 0;
+    napi_get_value_string_utf8(env, v, nullptr, 0, &length);
+    if (length < sizeof(d.xtrace)) {
+      napi_get_value_string_utf8(env, v, d.xtrace, sizeof(d.xtrace), &d.xtrace_len);
+    }
+  }
+
+  // make sure it's the right length before calling oboe.
+  if (d.xtrace_len == TraceContext::kTraceparentLength) {
+    if (!TraceContext::decodeTraceparent(d.xtrace, d.xtrace_len, d.omd)) {
+      d.xtrace_len = 0;
+    }
+  } else if (d.xtrace_len == 60) {
+    oboe_metadata_init(&d.omd);
+    int status = oboe_metadata_fromstr(&d.omd, d.xtrace, d.xtrace_len);
+    // status can be zero with a version other than 2, so check that too.
+    if (status < 0) {
+      d.xtrace_len = 0;
+    }
+  } else {
+    // if it's the wrong length don't pass it to oboe
+    d.xtrace_len = 0;
+  }
+}
+
+//
+// read the getTraceSettings() options, or just an xtrace, ask oboe for its
+// decisions and, if the status isn't an error, set up the metadata for the
+// span.
+//
+// returns the status from oboe_tracing_decisions().
+//
+static int make_trace_decision(Napi::Value options, TraceDecision& d) {
+  // in defaults
+  int rate = -1;
+  int mode = -1;
 
   //
   // trigger trace extensions
@@ -110,41 +158,40 @@ Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
 
   // type_requested 0 = normal, 1 = trigger-trace
   int type_requested = 0;
-  std::string xtraceOpts;
-  std::string xtraceOptsSig;
   int64_t xtraceOptsTimestamp = 0;
   int customTriggerMode = -1;
 
+  const char* bytes;
+  size_t length;
+
   // caller specified values. errors are ignored and default values are used.
-  if (info[0].IsObject()) {
-    Napi::Object o = info[0].ToObject();
+  if (options.IsString() || TraceContext::getBytes(options, bytes, length)) {
+    // just the xtrace.
+    read_xtrace(options.Env(), options, d);
+  } else if (options.IsObject()) {
+    Napi::Object o = options.ToObject();
 
     // is an xtrace supplied?
-    Napi::Value v = o.Get("xtrace");
-    if (v.IsString()) {
-      xtrace = v.As<Napi::String>();
-
-      // make sure it's the right length before calling oboe.
-      if (xtrace.length() == 60 || xtrace.length() == 55) {
-        // try to convert it to metadata. if it fails act as if no xtrace was
-        // supplied.
-        oboe_metadata_init(&omd);
-        int status = oboe_metadata_fromstr(&omd, xtrace.c_str(), xtrace.length());
-        // status can be zero with a version other than 2, so check that too.
-        if (status < 0) {
-          xtrace = "";
-        }
+    read_xtrace(o.Env(), o.Get("xtrace"), d);
+
+    Napi::Value v = o.Get("tracestate");
+    if (TraceContext::getBytes(v, bytes, length)) {
+      d.tracestate.assign(bytes, length);
+    } else if (v.IsString()) {
+      d.tracestate = v.As<Napi::String>();
+    }
+    // the sw value never contains '=' so this is a whole tracestate header;
+    // oboe only wants the sw member's value.
+    if (d.tracestate.find('=') != std::string::npos) {
+      const char* sw;
+      size_t sw_length;
+      if (TraceContext::findSwMember(d.tracestate.data(), d.tracestate.length(), sw, sw_length)) {
+        d.tracestate = std::string(sw, sw_length);
       } else {
-        // if it's the wrong length don't pass it to oboe
-        xtrace = "";
+        d.tracestate.clear();
       }
     }
 
-    v = o.Get("tracestate");
-    if (v.IsString()) {
-      tracestate = v.As<Napi::String>();
-    }
-
     // now get the much simpler integer values
     v = o.Get("rate");
     if (v.IsNumber()) {
@@ -160,7 +207,7 @@ Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
     // this might need to be done but it does add some control
     // for testing or unforseen cases.
     if (o.Has("edge")) {
-      edge = o.Get("edge").ToBoolean().Value();
+      d.edge = o.Get("edge").ToBoolean().Value();
     }
 
     // now handle x-trace-options and x-trace-options-signature
@@ -170,11 +217,11 @@ Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
     }
     v = o.Get("xtraceOpts");
     if (v.IsString()) {
-      xtraceOpts = v.As<Napi::String>();
+      d.xtraceOpts = v.As<Napi::String>();
     }
     v = o.Get("xtraceOptsSig");
     if (v.IsString()) {
-      xtraceOptsSig = v.As<Napi::String>();
+      d.xtraceOptsSig = v.As<Napi::String>();
     }
     v = o.Get("xtraceOptsTimestamp");
     if (v.IsNumber()) {
@@ -184,20 +231,54 @@ Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
     if (v.IsNumber()) {
       customTriggerMode = v.As<Napi::Number>().Int32Value();
     }
+
+    // a route's sampling policy, either by id or by matching the url.
+    SamplingPolicies::Policy policy;
+    bool have_policy = false;
+    int64_t id;
+    v = o.Get("policy");
+    if (v.IsNumber()) {
+      have_policy = SamplingPolicies::get(v.As<Napi::Number>().Int64Value(), policy);
+    } else {
+      v = o.Get("url");
+      if (TraceContext::getBytes(v, bytes, length)) {
+        have_policy = SamplingPolicies::match(bytes, length, id, policy);
+      } else if (v.IsString()) {
+        std::string url = v.As<Napi::String>();
+        have_policy = SamplingPolicies::match(url.data(), url.length(), id, policy);
+      }
+    }
+    // values supplied by the caller take precedence.
+    if (have_policy) {
+      if (mode == -1) {
+        mode = policy.mode;
+      }
+      if (rate == -1) {
+        rate = policy.rate;
+      }
+      if (customTriggerMode == -1) {
+        customTriggerMode = policy.trigger_mode;
+      }
+    }
   }
 
+  // scale the rate down if the event loop is lagging.
+  int scaled_source;
+  int scaled_rate = AdaptiveSampling::scaleRate(rate, scaled_source);
+
   // apply default or user specified values.
+  oboe_tracing_decisions_in_t& in = d.in;
 
   in.version = 3;
   in.service_name = "";
-  in.tracestate = tracestate.c_str();
-  in.custom_sample_rate = rate;
+  in.tracestate = d.tracestate.c_str();
+  in.custom_sample_rate = scaled_rate;
   in.custom_tracing_mode = mode;
 
   // oboe logs an error for an empty xtrace (and then ignores it)
   // only set key when existing
-  if(!xtrace.empty()) {
-    in.in_xtrace = xtrace.c_str();
+  if (d.xtrace_len) {
+    in.in_xtrace = d.xtrace;
   } else {
     in.in_xtrace = nullptr;
   }
@@ -205,13 +286,38 @@ Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
   // v2 fields (added for trigger-trace support)
   in.custom_trigger_mode = customTriggerMode;
   in.request_type = type_requested;
-  in.header_options = xtraceOpts.c_str();
-  in.header_signature = xtraceOptsSig.c_str();
+  in.header_options = d.xtraceOpts.c_str();
+  in.header_signature = d.xtraceOptsSig.c_str();
   in.header_timestamp = xtraceOptsTimestamp;
 
   // ask for oboe's decisions on life, the universe, and everything.
-  out.version = 3;
-  int status = oboe_tracing_decisions(&in, &out);
+  d.out.version = 3;
+  // a signed trigger trace request that was already rejected isn't sent to
+  // oboe again; the result it gave is reproduced so the rejection costs
+  // neither an HMAC nor sampling capacity.
+  if (SignatureCache::rejected(d.xtraceOpts, d.xtraceOptsSig, xtraceOptsTimestamp)) {
+    d.status = OBOE_TRACING_DECISIONS_FAILED_AUTH;
+    d.out.sample_rate = -1;
+    d.out.sample_source = -1;
+    d.out.do_sample = 0;
+    d.out.do_metrics = 0;
+    d.out.request_provisioned = 0;
+    d.out.auth_status = OBOE_TRACING_DECISIONS_AUTH_INVALID_SIG;
+    d.out.auth_message = oboe_get_tracing_decisions_auth_message(d.out.auth_status);
+    d.out.status_message = oboe_get_tracing_decisions_message(d.status);
+    d.out.token_bucket_rate = -1;
+    d.out.token_bucket_capacity = -1;
+  } else {
+    uint64_t start = uv_hrtime();
+    d.status = oboe_tracing_decisions(&in, &d.out);
+    DecisionStats::record(d.status, uv_hrtime() - start);
+    SignatureCache::store(d.xtraceOpts, d.xtraceOptsSig, xtraceOptsTimestamp, d.out.auth_status);
+  }
+
+  // oboe's own rate was scaled; report where it came from, not a custom rate.
+  if (scaled_source >= 0 && d.status <= 0 && d.out.sample_source == OBOE_SAMPLE_RATE_SOURCE_CUSTOM) {
+    d.out.sample_source = scaled_source;
+  }
 
   // version 2+ of the oboe_tracing_decisions_out structure returns a
   // pointer to the message string for all codes.
@@ -220,54 +326,79 @@ Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
   // -1 xtrace-not-sampled
   // 0 ok
 
-
-  // set the message and auth info for both error and successful returns
-  Napi::Object o = Napi::Object::New(env);
-  o.Set("status", Napi::Number::New(env, status));
-  o.Set("message", Napi::String::New(env, out.status_message));
-  o.Set("authStatus", Napi::Number::New(env, out.auth_status));
-  o.Set("authMessage", Napi::String::New(env, out.auth_message));
-  o.Set("typeProvisioned", Napi::Number::New(env, out.request_provisioned));
-
   // status > 0 is an error return; do no additional processing.
-  if (status > 0) {
-    return o;
+  if (d.status > 0) {
+    return d.status;
   }
 
-  have_metadata = in.in_xtrace != nullptr;
+  d.have_metadata = in.in_xtrace != nullptr;
 
   // if an x-trace was not used by oboe to make the decision then
   // there is need to create metadata.
-  if (!have_metadata) {
-    edge = false;
-    oboe_metadata_init(&omd);
-    oboe_metadata_random(&omd);
+  if (!d.have_metadata) {
+    d.edge = false;
+    IdGenerator::randomMetadata(d.omd);
   }
 
   // now we have oboe_metadata_t either from a supplied xtrace id or from
   // a Metadata object created for this span. set the sample bit to match
-  // the sample decision and create a JavaScript Metadata instance.
-  if (out.do_sample) {
-    omd.flags |= XTR_FLAGS_SAMPLED;
+  // the sample decision.
+  if (d.out.do_sample) {
+    d.omd.flags |= XTR_FLAGS_SAMPLED;
   } else {
-    omd.flags &= ~XTR_FLAGS_SAMPLED;
+    d.omd.flags &= ~XTR_FLAGS_SAMPLED;
   }
 
-  Napi::Object event = Event::makeFromOboeMetadata(env, omd);
-  //Napi::Value v = Napi::External<oboe_metadata_t>::New(env, &omd);
-  //Napi::Object md = Metadata::NewInstance(env, v);
-
   // oboe sets these if not continued, for when that change will be made
   //out->sample_rate = -1;
   //out->sample_source = -1;
   //out->token_bucket_rate = -1;
   //out->token_bucket_capacity = -1;
 
+  return d.status;
+}
+
+//
+// New function to start a trace. It returns all information
+// necessary in a single call.
+//
+// getTraceSettings(object)
+//
+// object.xtrace - an xtrace or traceparent string, Buffer or Uint8Array
+// object.tracestate - the sw tracestate value or the whole tracestate header,
+// string, Buffer or Uint8Array
+// object.mode - a route-specific trace mode, 0 or 1 for 'never'
+// or 'always' object.rate - a route-specific sampling rate
+// object.edge - override the default edge setting.
+// object.policy - the id of a sampling policy to apply
+// object.url - the request's url, to find the sampling policy to apply
+//
+Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  TraceDecision d;
+  int status = make_trace_decision(info[0], d);
+  const oboe_tracing_decisions_out_t& out = d.out;
+
+  // set the message and auth info for both error and successful returns
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("status", Napi::Number::New(env, status));
+  o.Set("message", Napi::String::New(env, out.status_message));
+  o.Set("authStatus", Napi::Number::New(env, out.auth_status));
+  o.Set("authMessage", Napi::String::New(env, out.auth_message));
+  o.Set("typeProvisioned", Napi::Number::New(env, out.request_provisioned));
+
+  // status > 0 is an error return; do no additional processing.
+  if (status > 0) {
+    return o;
+  }
+
+  Napi::Object event = Event::makeFromOboeMetadata(env, d.omd);
+
   // augment the return object
   o.Set("metadata", event);
-  o.Set("metadataFromXtrace", Napi::Boolean::New(env, have_metadata));
-  //o.Set("status", Napi::Number::New(env, status));
-  o.Set("edge", Napi::Boolean::New(env, edge));
+  o.Set("metadataFromXtrace", Napi::Boolean::New(env, d.have_metadata));
+  o.Set("edge", Napi::Boolean::New(env, d.edge));
   o.Set("doSample", Napi::Boolean::New(env, out.do_sample));
   o.Set("doMetrics", Napi::Boolean::New(env, out.do_metrics));
   o.Set("source", Napi::Number::New(env, out.sample_source));
@@ -278,6 +409,185 @@ Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
   return o;
 }
 
+//
+// the positions of the fields written by getTraceSettingsInto(). booleans
+// are written as 0 or 1.
+//
+enum TraceSettingsField {
+  kTsStatus,
+  kTsAuthStatus,
+  kTsTypeProvisioned,
+  kTsMetadataFromXtrace,
+  kTsEdge,
+  kTsDoSample,
+  kTsDoMetrics,
+  kTsSource,
+  kTsRate,
+  kTsTokenBucketRate,
+  kTsTokenBucketCapacity,
+  kTsFieldCount
+};
+
+static const char* trace_settings_fields[kTsFieldCount] = {
+  "status", "authStatus", "typeProvisioned", "metadataFromXtrace", "edge",
+  "doSample", "doMetrics", "source", "rate", "tokenBucketRate", "tokenBucketCapacity"
+};
+
+template <typename T>
+static void write_trace_settings(T* fields, const TraceDecision& d) {
+  const oboe_tracing_decisions_out_t& out = d.out;
+  fields[kTsStatus] = d.status;
+  fields[kTsAuthStatus] = out.auth_status;
+  fields[kTsTypeProvisioned] = out.request_provisioned;
+  // the remaining fields are only valid if the status isn't an error.
+  bool ok = d.status <= 0;
+  fields[kTsMetadataFromXtrace] = ok && d.have_metadata;
+  fields[kTsEdge] = ok && d.edge;
+  fields[kTsDoSample] = ok && out.do_sample;
+  fields[kTsDoMetrics] = ok && out.do_metrics;
+  fields[kTsSource] = ok ? out.sample_source : 0;
+  fields[kTsRate] = ok ? out.sample_rate : 0;
+  fields[kTsTokenBucketRate] = ok ? out.token_bucket_rate : 0;
+  fields[kTsTokenBucketCapacity] = ok ? out.token_bucket_capacity : 0;
+}
+
+//
+// getTraceSettingsInto(object, fields)
+//
+// the same as getTraceSettings() but the numeric and boolean results are
+// written into fields, an Int32Array or Float64Array with at least
+// Settings.traceSettingsFields.length elements, at the positions given by
+// Settings.traceSettingsFields. the token bucket values are truncated in an
+// Int32Array.
+//
+// returns the metadata Event or undefined if the status is an error. the
+// messages can be looked up with getTraceSettingsMessage() and
+// getTraceSettingsAuthMessage().
+//
+Napi::Value getTraceSettingsInto(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[1].IsTypedArray()) {
+    Napi::TypeError::New(env, "getTraceSettingsInto() - fields must be an Int32Array or Float64Array").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  Napi::TypedArray fields = info[1].As<Napi::TypedArray>();
+  napi_typedarray_type type = fields.TypedArrayType();
+  if (type != napi_int32_array && type != napi_float64_array) {
+    Napi::TypeError::New(env, "getTraceSettingsInto() - fields must be an Int32Array or Float64Array").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (fields.ElementLength() < kTsFieldCount) {
+    Napi::RangeError::New(env, "getTraceSettingsInto() - fields is too short").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  TraceDecision d;
+  int status = make_trace_decision(info[0], d);
+
+  if (type == napi_int32_array) {
+    write_trace_settings(fields.As<Napi::Int32Array>().Data(), d);
+  } else {
+    write_trace_settings(fields.As<Napi::Float64Array>().Data(), d);
+  }
+
+  if (status > 0) {
+    return env.Undefined();
+  }
+  return Event::makeFromOboeMetadata(env, d.omd);
+}
+
+//
+// bytes per entry in the getTraceSettingsBatch() metadata buffer, the same
+// layout that Event.makeFromBuffer() takes: a version byte, the trace id,
+// the parent id and the flags. only the first 16 bytes of a legacy 60
+// character xtrace's task id fit.
+//
+const size_t kPackedMetadataLength = 1 + OBOE_TASK_ID_TRACEPARENT_LEN + OBOE_MAX_OP_ID_LEN + 1;
+
+//
+// getTraceSettingsBatch(entries)
+//
+// entries is an array where each entry is either the options for
+// getTraceSettings() or just an xtrace string, Buffer or Uint8Array.
+//
+// returns columnar results:
+// {
+//   status: Int32Array - the status of each decision,
+//   doSample: Uint8Array - bitmap of the sample decisions, entry i is bit
+//             (i & 7) of byte (i >> 3),
+//   edge: Uint8Array - bitmap of the entries whose metadata came from the
+//         xtrace and should be edged back to,
+//   metadata: Buffer - kPackedMetadataLength bytes for each entry; use
+//             Event.makeFromBuffer(metadata.subarray(i * 26, i * 26 + 26)).
+//             zeros if the status is an error.
+// }
+//
+Napi::Value getTraceSettingsBatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    Napi::TypeError::New(env, "getTraceSettingsBatch() - entries must be an array").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  Napi::Array entries = info[0].As<Napi::Array>();
+  uint32_t count = entries.Length();
+  size_t bitmap_bytes = (count + 7) / 8;
+
+  Napi::Int32Array status = Napi::Int32Array::New(env, count);
+  Napi::Uint8Array do_sample = Napi::Uint8Array::New(env, bitmap_bytes);
+  Napi::Uint8Array edge = Napi::Uint8Array::New(env, bitmap_bytes);
+  Napi::Buffer<uint8_t> metadata = Napi::Buffer<uint8_t>::New(env, count * kPackedMetadataLength);
+
+  int32_t* s = status.Data();
+  uint8_t* ds = do_sample.Data();
+  uint8_t* e = edge.Data();
+  uint8_t* md = metadata.Data();
+  memset(md, 0, metadata.Length());
+
+  for (uint32_t i = 0; i < count; i++) {
+    TraceDecision d;
+    s[i] = make_trace_decision(entries.Get(i), d);
+    if (s[i] > 0) {
+      continue;
+    }
+    uint8_t bit = 1 << (i & 7);
+    if (d.out.do_sample) {
+      ds[i >> 3] |= bit;
+    }
+    if (d.edge) {
+      e[i >> 3] |= bit;
+    }
+    uint8_t* p = md + i * kPackedMetadataLength;
+    memcpy(p + 1, d.omd.ids.task_id, OBOE_TASK_ID_TRACEPARENT_LEN);
+    memcpy(p + 1 + OBOE_TASK_ID_TRACEPARENT_LEN, d.omd.ids.op_id, OBOE_MAX_OP_ID_LEN);
+    p[kPackedMetadataLength - 1] = d.omd.flags;
+  }
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("status", status);
+  o.Set("doSample", do_sample);
+  o.Set("edge", edge);
+  o.Set("metadata", metadata);
+  return o;
+}
+
+//
+// getTraceSettingsMessage(status) - the message for a getTraceSettings() status
+//
+Napi::Value getTraceSettingsMessage(const Napi::CallbackInfo& info) {
+  int code = info[0].IsNumber() ? info[0].As<Napi::Number>().Int32Value() : 0;
+  return Napi::String::New(info.Env(), oboe_get_tracing_decisions_message(code));
+}
+
+//
+// getTraceSettingsAuthMessage(authStatus) - the message for an authStatus
+//
+Napi::Value getTraceSettingsAuthMessage(const Napi::CallbackInfo& info) {
+  int code = info[0].IsNumber() ? info[0].As<Napi::Number>().Int32Value() : 0;
+  return Napi::String::New(info.Env(), oboe_get_tracing_decisions_auth_message(code));
+}
+
 //
 // This is not a class, just a group of functions in a JavaScript namespace.
 // (well, in two javascript namespaces for compatability.)
@@ -293,6 +603,22 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
   module.Set("setDefaultSampleRate", Napi::Function::New(env, setDefaultSampleRate));
 
   module.Set("getTraceSettings", Napi::Function::New(env, getTraceSettings));
+  module.Set("getTraceSettingsInto", Napi::Function::New(env, getTraceSettingsInto));
+  module.Set("getTraceSettingsBatch", Napi::Function::New(env, getTraceSettingsBatch));
+  module.Set("setSamplingPolicies", Napi::Function::New(env, SamplingPolicies::set));
+  module.Set("matchSamplingPolicy", Napi::Function::New(env, SamplingPolicies::matchUrl));
+  module.Set("getAdaptiveSampling", Napi::Function::New(env, AdaptiveSampling::getState));
+  module.Set("getDecisionStats", Napi::Function::New(env, DecisionStats::getStats));
+  module.Set("getSignatureCacheStats", Napi::Function::New(env, SignatureCache::getStats));
+  module.Set("getTraceSettingsMessage", Napi::Function::New(env, getTraceSettingsMessage));
+  module.Set("getTraceSettingsAuthMessage", Napi::Function::New(env, getTraceSettingsAuthMessage));
+
+  Napi::Object fields = Napi::Object::New(env);
+  for (int i = 0; i < kTsFieldCount; i++) {
+    fields.Set(trace_settings_fields[i], Napi::Number::New(env, i));
+  }
+  fields.Set("length", Napi::Number::New(env, kTsFieldCount));
+  module.Set("traceSettingsFields", fields);
 
   exports.Set("Settings", module);
 
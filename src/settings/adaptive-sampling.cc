@@ -0,0 +1,287 @@
+#include "bindings.h"
+#include "settings/settings.h"
+#include "metrics/hdr_histogram.h"
+#include "uv.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+//
+// Load-adaptive sampling.
+//
+// Sampled requests cost more than unsampled ones so an overloaded process
+// sheds tracing first. Event loop lag is measured with a repeating timer;
+// the difference between when it fires and when it was due is the lag. At
+// the end of each window the p99 lag is compared to two thresholds:
+//
+// - above highLag the sample rate multiplier is cut by the decrease factor
+// - below lowLag it is raised by the increase factor, up to 1
+// - in between it's left alone, so the rate doesn't flap around a single
+//   threshold.
+//
+// The multiplier scales the sample rate passed to oboe_tracing_decisions().
+// When neither the caller nor a sampling policy supplies a rate oboe's
+// current rate, from oboe_settings_cfg_get(), is scaled and the decision
+// reports that rate's source rather than a custom one.
+//
+// Decisions are made on every thread; the lag is measured on the loop of
+// the one environment that owns the timer.
+//
+// The metrics addon is a separate module, so the lag is measured here
+// rather than shared with src/metrics/eventloop.cc.
+//
+namespace AdaptiveSampling {
+
+// the largest lag recorded is a minute.
+const int64_t kHighestTrackable = INT64_C(60000000);
+
+static std::atomic<bool> enabled(false);
+
+// configuration, times in milliseconds
+static double high_lag = 100;
+static double low_lag = 50;
+static double decrease = 0.5;
+static double increase = 1.25;
+static double min_multiplier = 0.01;
+static uint64_t interval = 10;
+static uint64_t window = 1000;
+
+static std::atomic<double> multiplier(1.0);
+static std::atomic<double> last_p99(0);
+
+static std::atomic<uint64_t> windows(0);
+static std::atomic<uint64_t> decreases(0);
+static std::atomic<uint64_t> increases(0);
+
+// the environment whose loop runs the timer. it's claimed by the first
+// environment to enable adaptive sampling and released when that
+// environment is torn down.
+static std::atomic<napi_env> owner_env(nullptr);
+// only used on owner_env's thread. allocated when it's claimed and freed
+// when it's closed.
+static uv_timer_t* timer = nullptr;
+static struct hdr_histogram* hist = nullptr;
+static uint64_t last_tick = 0;
+static uint64_t window_start = 0;
+
+static void evaluate() {
+  windows += 1;
+  if (hdr_min(hist) == INT64_MAX) {
+    return;
+  }
+  double p99 = hdr_value_at_percentile(hist, 99.0) / 1000.0;
+  last_p99 = p99;
+  hdr_reset(hist);
+
+  double current = multiplier;
+  if (p99 > high_lag) {
+    double m = std::max(min_multiplier, current * decrease);
+    if (m < current) {
+      multiplier = m;
+      decreases += 1;
+    }
+  } else if (p99 < low_lag && current < 1.0) {
+    multiplier = std::min(1.0, current * increase);
+    increases += 1;
+  }
+}
+
+static void sample_cb(uv_timer_t* handle) {
+  uint64_t now = uv_hrtime();
+  int64_t lag = static_cast<int64_t>((now - last_tick) / 1000) - static_cast<int64_t>(interval * 1000);
+  last_tick = now;
+  hdr_record_value(hist, std::min(std::max(lag, INT64_C(1)), kHighestTrackable));
+
+  if (now - window_start >= window * 1000000) {
+    evaluate();
+    window_start = now;
+  }
+}
+
+//
+// get oboe's current sample rate and its source, -1 if there isn't one.
+//
+static int oboe_rate(int& source) {
+  oboe_settings_cfg_t* cfg = oboe_settings_cfg_get();
+  if (cfg == NULL) {
+    return -1;
+  }
+  // a locally configured rate overrides the one from the collector.
+  if (cfg->sample_rate >= 0) {
+    source = OBOE_SAMPLE_RATE_SOURCE_FILE;
+    return cfg->sample_rate;
+  }
+  source = OBOE_SAMPLE_RATE_SOURCE_OBOE;
+  return cfg->settings ? cfg->last_auto_sample_rate : -1;
+}
+
+//
+// scale a sample rate by the multiplier. rate is -1 if neither the caller
+// nor a policy supplied one. returns the rate to pass to oboe. source is
+// set to the sample source the decision should report if oboe's own rate
+// was scaled, otherwise -1.
+//
+int scaleRate(int rate, int& source) {
+  source = -1;
+  double m = multiplier;
+  if (!enabled || m >= 1.0) {
+    return rate;
+  }
+  if (rate < 0) {
+    int s;
+    rate = oboe_rate(s);
+    if (rate < 0) {
+      return -1;
+    }
+    source = s;
+  }
+  return static_cast<int>(std::floor(rate * m));
+}
+
+static void stop() {
+  if (timer) {
+    uv_timer_stop(timer);
+  }
+  enabled = false;
+  multiplier = 1.0;
+}
+
+static void cleanup(void*) {
+  stop();
+  if (timer) {
+    uv_close(reinterpret_cast<uv_handle_t*>(timer), [](uv_handle_t* handle) {
+      delete reinterpret_cast<uv_timer_t*>(handle);
+    });
+    timer = nullptr;
+  }
+  owner_env.store(nullptr);
+}
+
+static double get_number(Napi::Object o, const char* name, double def) {
+  Napi::Value v = o.Get(name);
+  return v.IsNumber() ? v.As<Napi::Number>().DoubleValue() : def;
+}
+
+//
+// configure from the oboeInit() adaptiveSampling option which is either a
+// boolean or an object:
+//
+// options.highLag - p99 lag, in milliseconds, above which the rate is
+//                   decreased (default 100)
+// options.lowLag - p99 lag below which the rate recovers (default 50)
+// options.decrease - factor applied when lag is high (default 0.5)
+// options.increase - factor applied when lag is low (default 1.25)
+// options.minMultiplier - the lowest the multiplier goes (default 0.01)
+// options.interval - milliseconds between lag samples (default 10)
+// options.window - milliseconds between adjustments (default 1000)
+//
+// only the thread that first enables it can reconfigure it.
+//
+bool configure(Napi::Value v) {
+  napi_env env = v.Env();
+  // the timer belongs to another thread's loop.
+  napi_env owner = owner_env.load();
+  if (owner && owner != env) {
+    return false;
+  }
+
+  double hl = 100, ll = 50, d = 0.5, i = 1.25, mm = 0.01, in = 10, w = 1000;
+  bool enable;
+  if (v.IsBoolean()) {
+    enable = v.As<Napi::Boolean>().Value();
+  } else if (v.IsObject() && !v.IsArray()) {
+    Napi::Object o = v.As<Napi::Object>();
+    hl = get_number(o, "highLag", hl);
+    ll = get_number(o, "lowLag", ll);
+    d = get_number(o, "decrease", d);
+    i = get_number(o, "increase", i);
+    mm = get_number(o, "minMultiplier", mm);
+    in = get_number(o, "interval", in);
+    w = get_number(o, "window", w);
+    if (!(ll >= 0 && ll < hl) || !(d > 0 && d < 1) || !(i > 1) || !(mm > 0 && mm <= 1)
+        || !(in >= 1) || !(w >= in)) {
+      return false;
+    }
+    enable = true;
+  } else {
+    return false;
+  }
+
+  if (!enable) {
+    if (owner) {
+      stop();
+    }
+    return true;
+  }
+
+  napi_env expected = nullptr;
+  if (owner_env.compare_exchange_strong(expected, env)) {
+    napi_add_env_cleanup_hook(env, cleanup, nullptr);
+  } else if (expected != env) {
+    return false;
+  }
+  stop();
+
+  if (!hist && hdr_init(1, kHighestTrackable, 2, &hist) != 0) {
+    hist = nullptr;
+    return false;
+  }
+  hdr_reset(hist);
+
+  high_lag = hl;
+  low_lag = ll;
+  decrease = d;
+  increase = i;
+  min_multiplier = mm;
+  interval = in;
+  window = w;
+  last_p99 = 0;
+
+  if (!timer) {
+    uv_loop_t* loop;
+    napi_get_uv_event_loop(env, &loop);
+    timer = new uv_timer_t;
+    uv_timer_init(loop, timer);
+    // don't keep the process alive just to measure lag.
+    uv_unref(reinterpret_cast<uv_handle_t*>(timer));
+  }
+  last_tick = window_start = uv_hrtime();
+  uv_timer_start(timer, sample_cb, interval, interval);
+  enabled = true;
+
+  return true;
+}
+
+//
+// JavaScript callable
+//
+// getAdaptiveSampling(options)
+//
+// options.reset - reset the counts after reading them.
+//
+// returns {enabled, multiplier, lagP99, baseRate, windows, decreases,
+// increases}. lagP99 is the p99 event loop lag, in milliseconds, of the
+// last window with samples. baseRate is oboe's current rate, the one scaled
+// when the caller doesn't supply one, or -1 if oboe doesn't have one.
+//
+Napi::Value getState(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  bool reset = false;
+  if (info.Length() == 1 && info[0].IsObject()) {
+    reset = info[0].ToObject().Get("reset").ToBoolean().Value();
+  }
+  int source;
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("enabled", Napi::Boolean::New(env, enabled.load()));
+  o.Set("multiplier", Napi::Number::New(env, multiplier.load()));
+  o.Set("lagP99", Napi::Number::New(env, last_p99.load()));
+  o.Set("baseRate", Napi::Number::New(env, oboe_rate(source)));
+  o.Set("windows", Napi::Number::New(env, reset ? windows.exchange(0) : windows.load()));
+  o.Set("decreases", Napi::Number::New(env, reset ? decreases.exchange(0) : decreases.load()));
+  o.Set("increases", Napi::Number::New(env, reset ? increases.exchange(0) : increases.load()));
+
+  return o;
+}
+
+} // end namespace AdaptiveSampling
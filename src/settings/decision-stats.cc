@@ -0,0 +1,123 @@
+#include "bindings.h"
+#include "settings/settings.h"
+#include "metrics/hdr_histogram.h"
+
+//
+// Latency of oboe_tracing_decisions().
+//
+// Every call is timed and recorded in a histogram for its status so stalls,
+// e.g., waiting on a lock while settings are refreshed, show up in the
+// percentiles and max. Times are recorded in nanoseconds and reported in
+// microseconds. A histogram is only allocated once a status is seen.
+//
+namespace DecisionStats {
+
+// the largest time recorded is ten seconds.
+const int64_t kHighestTrackable = INT64_C(10000000000);
+const int kSignificantFigures = 2;
+
+// statuses from OBOE_TRACING_DECISIONS_FAILED_AUTH to
+// OBOE_TRACING_DECISIONS_BAD_ARG have their own histograms; any others
+// share the last one.
+const int kMinStatus = OBOE_TRACING_DECISIONS_FAILED_AUTH;
+const int kMaxStatus = OBOE_TRACING_DECISIONS_BAD_ARG;
+const int kOther = kMaxStatus - kMinStatus + 1;
+
+static struct hdr_histogram* histograms[kOther + 1] = {nullptr};
+
+// reused to combine the histograms when they're read.
+static struct hdr_histogram* total = nullptr;
+
+static const struct {
+  const char* name;
+  double percentile;
+} PERCENTILES[] = {
+  {"p50", 50.0}, {"p90", 90.0}, {"p99", 99.0}, {"p999", 99.9}
+};
+
+void record(int status, uint64_t ns) {
+  int i = status >= kMinStatus && status <= kMaxStatus ? status - kMinStatus : kOther;
+  if (!histograms[i] && hdr_init(1, kHighestTrackable, kSignificantFigures, &histograms[i]) != 0) {
+    histograms[i] = nullptr;
+    return;
+  }
+  int64_t v = static_cast<int64_t>(ns);
+  if (v < 1) {
+    v = 1;
+  } else if (v > kHighestTrackable) {
+    v = kHighestTrackable;
+  }
+  hdr_record_value(histograms[i], v);
+}
+
+static Napi::Object histogram_value(Napi::Env env, struct hdr_histogram* h) {
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("count", Napi::Number::New(env, h->total_count));
+  o.Set("min", Napi::Number::New(env, hdr_min(h) / 1000.0));
+  for (const auto& p : PERCENTILES) {
+    o.Set(p.name, Napi::Number::New(env, hdr_value_at_percentile(h, p.percentile) / 1000.0));
+  }
+  o.Set("max", Napi::Number::New(env, hdr_max(h) / 1000.0));
+  return o;
+}
+
+//
+// JavaScript callable
+//
+// getDecisionStats(options)
+//
+// options.reset - start a new interval after reading the stats.
+//
+// returns {total, statuses} where total is the latency of all decisions and
+// statuses is keyed by the status code, or "other" for unexpected codes.
+// each is {count, min, p50, p90, p99, p999, max} in microseconds and the
+// statuses also have the status message. only statuses seen since the last
+// reset are present.
+//
+Napi::Value getStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  bool any = false;
+  Napi::Object statuses = Napi::Object::New(env);
+  for (int i = 0; i <= kOther; i++) {
+    struct hdr_histogram* h = histograms[i];
+    if (!h || h->total_count == 0) {
+      continue;
+    }
+    if (!total && hdr_init(1, kHighestTrackable, kSignificantFigures, &total) != 0) {
+      total = nullptr;
+    }
+    if (total) {
+      if (!any) {
+        hdr_reset(total);
+      }
+      hdr_add(total, h);
+      any = true;
+    }
+    Napi::Object o = histogram_value(env, h);
+    if (i == kOther) {
+      statuses.Set("other", o);
+    } else {
+      o.Set("message", Napi::String::New(env, oboe_get_tracing_decisions_message(i + kMinStatus)));
+      statuses.Set(std::to_string(i + kMinStatus), o);
+    }
+  }
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("total", any ? Napi::Value(histogram_value(env, total)) : env.Null());
+  o.Set("statuses", statuses);
+
+  if (info.Length() == 1 && info[0].IsObject()) {
+    if (info[0].ToObject().Get("reset").ToBoolean().Value()) {
+      for (struct hdr_histogram* h : histograms) {
+        if (h) {
+          hdr_reset(h);
+        }
+      }
+    }
+  }
+
+  return o;
+}
+
+} // end namespace DecisionStats
@@ -0,0 +1,216 @@
+#include "bindings.h"
+#include "settings/settings.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+//
+// Route-level sampling policies.
+//
+// A table of route patterns, each with a tracing mode, sample rate and
+// trigger trace mode, is registered once with setSamplingPolicies(). A
+// policy's id is its position in the table. getTraceSettings() then takes
+// either the id or the request's url and applies the policy without any
+// JavaScript lookup.
+//
+// Patterns are compiled when they're set: exact routes go in a hash map and
+// routes ending in '*' are prefixes kept longest first, so the most specific
+// prefix wins. An exact match takes precedence over any prefix.
+//
+// Every thread that loads the addon shares the table. It's never modified
+// once it's built; setSamplingPolicies() builds a new one and swaps it in
+// atomically. A lookup holds a reference to the table it started with, and
+// returns a copy of the policy, so a concurrent replacement can't free it.
+//
+namespace SamplingPolicies {
+
+struct Table {
+  std::vector<Policy> policies;
+  std::unordered_map<std::string, int64_t> exact;
+  std::vector<std::pair<std::string, int64_t>> prefixes;
+};
+
+// read and replaced with std::atomic_load() and std::atomic_store().
+static std::shared_ptr<const Table> table = std::make_shared<Table>();
+
+// reused for lookups so the path doesn't need an allocation.
+static thread_local std::string key;
+
+//
+// get the policy with the id. returns false if there isn't one.
+//
+bool get(int64_t id, Policy& policy) {
+  std::shared_ptr<const Table> t = std::atomic_load(&table);
+  if (id < 0 || static_cast<size_t>(id) >= t->policies.size()) {
+    return false;
+  }
+  policy = t->policies[id];
+  return true;
+}
+
+//
+// find the policy for a url. the scheme, host, query and fragment are
+// ignored. id is set to the policy's id or -1 if none matches. returns
+// false if none matches.
+//
+bool match(const char* url, size_t length, int64_t& id, Policy& policy) {
+  id = -1;
+  std::shared_ptr<const Table> t = std::atomic_load(&table);
+  if (t->policies.empty()) {
+    return false;
+  }
+
+  const char* path = url;
+  const char* end = url + length;
+
+  // skip the scheme and host of an absolute url. the scheme must start the
+  // url so a "://" in the query or fragment isn't mistaken for one.
+  if (path < end && isalpha(static_cast<unsigned char>(*path))) {
+    const char* p = path + 1;
+    while (p < end && (isalnum(static_cast<unsigned char>(*p)) || *p == '+' || *p == '.' || *p == '-')) {
+      p++;
+    }
+    if (end - p >= 3 && p[0] == ':' && p[1] == '/' && p[2] == '/') {
+      path = p + 3;
+      while (path < end && *path != '/' && *path != '?' && *path != '#') {
+        path++;
+      }
+    }
+  }
+  // stop at the query or fragment.
+  const char* stop = path;
+  while (stop < end && *stop != '?' && *stop != '#') {
+    stop++;
+  }
+  size_t path_length = stop - path;
+
+  key.assign(path, path_length);
+  auto it = t->exact.find(key);
+  if (it != t->exact.end()) {
+    id = it->second;
+    policy = t->policies[id];
+    return true;
+  }
+
+  for (const auto& prefix : t->prefixes) {
+    if (prefix.first.length() <= path_length
+        && memcmp(prefix.first.data(), path, prefix.first.length()) == 0) {
+      id = prefix.second;
+      policy = t->policies[id];
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static bool get_override(Napi::Object o, const char* name, int min, int max, int& value) {
+  Napi::Value v = o.Get(name);
+  if (v.IsUndefined()) {
+    return true;
+  }
+  if (!v.IsNumber()) {
+    return false;
+  }
+  int64_t n = v.As<Napi::Number>().Int64Value();
+  if (n < min || n > max) {
+    return false;
+  }
+  value = n;
+  return true;
+}
+
+//
+// JavaScript callable
+//
+// setSamplingPolicies(policies) replaces the policy table. each policy is
+// {route, mode, rate, triggerMode}:
+//
+// route - an exact path, e.g. '/health', or a prefix ending in '*', e.g.
+//         '/api/*'. '*' alone matches every route.
+// mode - the tracing mode, TRACE_NEVER or TRACE_ALWAYS (optional)
+// rate - the sample rate, 0 to MAX_SAMPLE_RATE (optional)
+// triggerMode - the trigger trace mode, 0 or 1 (optional)
+//
+// returns the number of policies. a policy's id is its index in the array;
+// ids cached from a previous table refer to the same index in the new one.
+//
+Napi::Value set(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    Napi::TypeError::New(env, "setSamplingPolicies() - policies must be an array").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  Napi::Array a = info[0].As<Napi::Array>();
+
+  std::shared_ptr<Table> t = std::make_shared<Table>();
+  std::vector<Policy>& new_policies = t->policies;
+  std::unordered_map<std::string, int64_t>& new_exact = t->exact;
+  std::vector<std::pair<std::string, int64_t>>& new_prefixes = t->prefixes;
+  new_policies.resize(a.Length());
+
+  for (uint32_t i = 0; i < a.Length(); i++) {
+    Napi::Value v = a.Get(i);
+    Napi::Value route = v.IsObject() ? v.ToObject().Get("route") : env.Undefined();
+    Policy& p = new_policies[i];
+    if (!route.IsString()
+        || !get_override(v.ToObject(), "mode", OBOE_TRACE_NEVER, OBOE_TRACE_ALWAYS, p.mode)
+        || !get_override(v.ToObject(), "rate", 0, OBOE_SAMPLE_RESOLUTION, p.rate)
+        || !get_override(v.ToObject(), "triggerMode", 0, 1, p.trigger_mode)) {
+      std::string message = "setSamplingPolicies() - invalid policy at index " + std::to_string(i);
+      Napi::TypeError::New(env, message).ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string r = route.As<Napi::String>();
+    if (!r.empty() && r.back() == '*') {
+      r.pop_back();
+      new_prefixes.emplace_back(r, i);
+    } else {
+      // the first policy for a route wins.
+      new_exact.emplace(r, i);
+    }
+  }
+
+  // longest first; the sort is stable so equal prefixes keep their order
+  // and the first one wins.
+  std::stable_sort(new_prefixes.begin(), new_prefixes.end(),
+                   [](const std::pair<std::string, int64_t>& a, const std::pair<std::string, int64_t>& b) {
+                     return a.first.length() > b.first.length();
+                   });
+
+  size_t count = new_policies.size();
+  std::atomic_store(&table, std::shared_ptr<const Table>(std::move(t)));
+
+  return Napi::Number::New(env, count);
+}
+
+//
+// JavaScript callable
+//
+// matchSamplingPolicy(url) returns the id of the policy for the url, a
+// string, Buffer or Uint8Array, or -1 if no policy matches. the id can be
+// cached and passed to getTraceSettings() as the policy option.
+//
+Napi::Value matchUrl(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  int64_t id = -1;
+  Policy policy;
+
+  const char* bytes;
+  size_t length;
+  if (info.Length() >= 1 && TraceContext::getBytes(info[0], bytes, length)) {
+    match(bytes, length, id, policy);
+  } else if (info.Length() >= 1 && info[0].IsString()) {
+    std::string url = info[0].As<Napi::String>();
+    match(url.data(), url.length(), id, policy);
+  }
+
+  return Napi::Number::New(env, id);
+}
+
+} // end namespace SamplingPolicies
@@ -0,0 +1,56 @@
+#ifndef NODE_OBOE_SETTINGS_H_
+#define NODE_OBOE_SETTINGS_H_
+
+#include "bindings.h"
+
+//
+// declarations shared by the files that implement the Settings namespace.
+//
+
+//
+// route-level sampling policies matched natively so per-route overrides
+// don't need a JavaScript lookup for every request.
+//
+namespace SamplingPolicies {
+  // -1 means the policy doesn't override the value.
+  struct Policy {
+    int mode = -1;
+    int rate = -1;
+    int trigger_mode = -1;
+  };
+
+  bool get(int64_t id, Policy& policy);
+  bool match(const char* url, size_t length, int64_t& id, Policy& policy);
+
+  Napi::Value set(const Napi::CallbackInfo&);
+  Napi::Value matchUrl(const Napi::CallbackInfo&);
+}
+
+//
+// scales the sample rate down when the event loop lags.
+//
+namespace AdaptiveSampling {
+  int scaleRate(int, int&);
+  bool configure(Napi::Value);
+  Napi::Value getState(const Napi::CallbackInfo&);
+}
+
+//
+// latency histograms of oboe_tracing_decisions() by status.
+//
+namespace DecisionStats {
+  void record(int, uint64_t);
+  Napi::Value getStats(const Napi::CallbackInfo&);
+}
+
+//
+// recently verified trigger trace signatures.
+//
+namespace SignatureCache {
+  bool rejected(const std::string&, const std::string&, int64_t);
+  void store(const std::string&, const std::string&, int64_t, int);
+  bool configure(Napi::Value);
+  Napi::Value getStats(const Napi::CallbackInfo&);
+}
+
+#endif  // NODE_OBOE_SETTINGS_H_
@@ -0,0 +1,197 @@
+#include "bindings.h"
+#include "settings/settings.h"
+#include "reporter/reporter.h"
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+//
+// Cache of rejected trigger trace signatures.
+//
+// Signed trigger trace requests carry x-trace-options, a signature and a
+// timestamp; oboe verifies the HMAC on every request. Whether a signature is
+// valid for an (options, signature, timestamp) tuple only depends on the key
+// so rejected tuples are kept in a small LRU until the timestamp falls out of
+// the validity window. A repeat of a rejected tuple is answered without
+// calling oboe, so a flood of bad signatures costs neither an HMAC nor any of
+// oboe's sampling capacity.
+//
+// Verified tuples aren't kept: oboe_tracing_decisions() has no way to be told
+// a signature was already checked so there'd be nothing to save.
+//
+// The cache is shared by all threads and guarded by a mutex.
+//
+namespace SignatureCache {
+
+struct Entry {
+  uint64_t hash;
+  std::string options;
+  std::string signature;
+  int64_t timestamp;
+  // unix seconds after which the entry is discarded.
+  int64_t expires;
+};
+
+static std::mutex mutex;
+
+static bool enabled = false;
+static size_t capacity = 1000;
+// seconds either side of the timestamp a signature is valid.
+static int64_t window = 5 * 60;
+
+// most recently used first.
+static std::list<Entry> lru;
+static std::unordered_map<uint64_t, std::list<Entry>::iterator> positions;
+
+static uint64_t hits = 0;
+static uint64_t misses = 0;
+static uint64_t expired = 0;
+
+static int64_t now_seconds() {
+  using namespace std::chrono;
+  return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t hash_tuple(const std::string& options, const std::string& signature, int64_t timestamp) {
+  uint64_t h = fnv1a(options.data(), options.length());
+  h = fnv1a(signature.data(), signature.length(), h ^ '\0');
+  return mix64(h ^ static_cast<uint64_t>(timestamp));
+}
+
+static void erase(std::unordered_map<uint64_t, std::list<Entry>::iterator>::iterator it) {
+  lru.erase(it->second);
+  positions.erase(it);
+}
+
+//
+// look up a signed trigger trace request. returns true if its signature
+// was already rejected.
+//
+bool rejected(const std::string& options, const std::string& signature, int64_t timestamp) {
+  if (signature.empty()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!enabled) {
+    return false;
+  }
+  uint64_t h = hash_tuple(options, signature, timestamp);
+  auto it = positions.find(h);
+  if (it == positions.end()) {
+    misses += 1;
+    return false;
+  }
+  Entry& e = *it->second;
+  if (e.options != options || e.signature != signature || e.timestamp != timestamp) {
+    misses += 1;
+    return false;
+  }
+  if (now_seconds() > e.expires) {
+    erase(it);
+    expired += 1;
+    misses += 1;
+    return false;
+  }
+  lru.splice(lru.begin(), lru, it->second);
+  hits += 1;
+  return true;
+}
+
+//
+// remember the outcome of a signed request's verification. only invalid
+// signatures are kept; a bad timestamp may become valid and anything else
+// wasn't a rejection.
+//
+void store(const std::string& options, const std::string& signature, int64_t timestamp,
+           int auth_status) {
+  if (signature.empty() || auth_status != OBOE_TRACING_DECISIONS_AUTH_INVALID_SIG) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!enabled) {
+    return;
+  }
+  uint64_t h = hash_tuple(options, signature, timestamp);
+  auto it = positions.find(h);
+  if (it != positions.end()) {
+    erase(it);
+  }
+
+  lru.push_front({h, options, signature, timestamp, timestamp + window});
+  positions[h] = lru.begin();
+
+  if (lru.size() > capacity) {
+    positions.erase(lru.back().hash);
+    lru.pop_back();
+  }
+}
+
+//
+// configure from the oboeInit() signatureCache option which is either a
+// boolean or an object:
+//
+// options.capacity - most tuples kept (default 1000)
+// options.window - seconds after its timestamp that a tuple expires
+//                  (default 300, oboe's validity window)
+//
+bool configure(Napi::Value v) {
+  bool e = true;
+  int64_t c = 1000;
+  int64_t w = 5 * 60;
+  if (v.IsBoolean()) {
+    e = v.As<Napi::Boolean>().Value();
+  } else if (v.IsObject() && !v.IsArray()) {
+    c = get_integer(v.As<Napi::Object>(), "capacity", 1000);
+    w = get_integer(v.As<Napi::Object>(), "window", 5 * 60);
+    if (c < 1 || w < 0) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  enabled = e;
+  if (v.IsObject()) {
+    capacity = c;
+    window = w;
+  }
+  lru.clear();
+  positions.clear();
+  return true;
+}
+
+//
+// JavaScript callable
+//
+// getSignatureCacheStats(options)
+//
+// options.reset - reset the counts after reading them.
+//
+// returns {size, hits, misses, expired}
+//
+Napi::Value getStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  bool reset = false;
+  if (info.Length() == 1 && info[0].IsObject()) {
+    reset = info[0].ToObject().Get("reset").ToBoolean().Value();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("size", Napi::Number::New(env, lru.size()));
+  o.Set("hits", Napi::Number::New(env, hits));
+  o.Set("misses", Napi::Number::New(env, misses));
+  o.Set("expired", Napi::Number::New(env, expired));
+
+  if (reset) {
+    hits = 0;
+    misses = 0;
+    expired = 0;
+  }
+
+  return o;
+}
+
+} // end namespace SignatureCache
@@ -55,6 +55,73 @@ describe('bindings.oboeInit()', function () {
     expect(ready).equal(1, 'collector should be ready')
   })
 
+  it('should check if ready to sample asynchronously', async function () {
+    this.timeout(maxIsReadyToSampleWait)
+    const ready = await bindings.isReadyToSampleAsync(maxIsReadyToSampleWait)
+    expect(ready).equal(1, 'collector should be ready')
+  })
+
+  it('should watch for changes in readiness', function () {
+    const changes = []
+    const status = bindings.onReadyToSampleChange((s, previous) => changes.push([s, previous]), { interval: 10 })
+    expect(status).equal(1)
+    expect(bindings.onReadyToSampleChange(null)).equal(1)
+    expect(() => bindings.onReadyToSampleChange('x')).throws('callback must be a function or null')
+    expect(changes).deep.equal([])
+  })
+
+  it('should call back when readiness changes', function (done) {
+    // starting from a status the collector can't have means the first check
+    // is a change.
+    bindings.onReadyToSampleChange((status, previous) => {
+      bindings.onReadyToSampleChange(null)
+      expect(status).equal(1)
+      expect(previous).equal(-1)
+      done()
+    }, { interval: 10, previous: -1 })
+  })
+
+  it('should only let one thread watch readiness at a time', function (done) {
+    const { Worker } = require('worker_threads')
+    bindings.onReadyToSampleChange(() => {}, { interval: 1000 })
+
+    const code = `
+      const { parentPort } = require('worker_threads')
+      const bindings = require(${JSON.stringify(require.resolve('../'))})
+      const watch = () => {
+        try {
+          bindings.onReadyToSampleChange(() => {})
+          bindings.onReadyToSampleChange(null)
+          return 'watched'
+        } catch (e) {
+          return e.message
+        }
+      }
+      parentPort.once('message', () => parentPort.postMessage(watch()))
+      parentPort.postMessage(watch())
+    `
+    const results = []
+    const worker = new Worker(code, { eval: true })
+    worker.on('message', m => {
+      results.push(m)
+      if (results.length === 1) {
+        // once the main thread stops the worker can watch.
+        bindings.onReadyToSampleChange(null)
+        worker.postMessage('again')
+      }
+    })
+    worker.on('error', done)
+    worker.on('exit', () => {
+      try {
+        expect(results[0]).match(/already watching on another thread/)
+        expect(results[1]).equal('watched')
+        done()
+      } catch (e) {
+        done(e)
+      }
+    })
+  })
+
   it('should handle good options values', function () {
     const details = {}
     const options = Object.assign({}, goodOptions)
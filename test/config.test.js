@@ -61,4 +61,91 @@ describe('bindings.Config', function () {
     expect(stats).property('collectorTryLater', 0)
     expect(stats).property('collectorLimitExceeded', 0)
   })
+
+  it('should read the settings snapshot', function () {
+    const fields = bindings.Config.settingsSnapshotFields
+    const view = bindings.Config.getSettingsSnapshot({ interval: 100 })
+    expect(view).instanceOf(Int32Array)
+    expect(view.length).equal(fields.length)
+    expect(view[fields.sequence] % 2).equal(0)
+
+    const snapshot = bindings.Config.readSettingsSnapshot(view)
+    expect(snapshot).to.have.all.keys(
+      'tracingMode',
+      'sampleRate',
+      'triggerMode',
+      'flags',
+      'timestamp',
+      'updates'
+    )
+    const settings = bindings.Config.getSettings()
+    expect(snapshot.tracingMode).equal(settings.tracing_mode)
+    expect(snapshot.sampleRate).equal(settings.sample_rate)
+  })
+
+  it('should read the settings snapshot into an object', function () {
+    const view = bindings.Config.getSettingsSnapshot({ interval: 100 })
+    const into = {}
+    expect(bindings.Config.readSettingsSnapshot(view, into)).equal(into)
+    expect(into).deep.equal(bindings.Config.readSettingsSnapshot(view))
+  })
+
+  it('should return the same view for each call', function () {
+    const a = bindings.Config.getSettingsSnapshot()
+    const b = bindings.Config.getSettingsSnapshot({ interval: 0 })
+    expect(a).equal(b)
+  })
+
+  it('should share the snapshot with a worker', function (done) {
+    const { Worker } = require('worker_threads')
+    const view = bindings.Config.getSettingsSnapshot({ interval: 100 })
+
+    const code = `
+      const { parentPort } = require('worker_threads')
+      const bindings = require(${JSON.stringify(require.resolve('../'))})
+      // the main thread writes the snapshot; the worker only reads it.
+      const view = bindings.Config.getSettingsSnapshot({ interval: 1 })
+      parentPort.postMessage(bindings.Config.readSettingsSnapshot(view))
+    `
+    const worker = new Worker(code, { eval: true })
+    worker.on('message', snapshot => {
+      expect(snapshot).deep.equal(bindings.Config.readSettingsSnapshot(view))
+    })
+    worker.on('error', done)
+    worker.on('exit', code => done(code ? new Error(`worker exited with ${code}`) : undefined))
+  })
+
+  it('should hand the snapshot writer over when a worker exits', function (done) {
+    const { Worker } = require('worker_threads')
+    // stop checking so the worker becomes the writer.
+    bindings.Config.getSettingsSnapshot({ interval: 0 })
+
+    const code = `
+      const { parentPort } = require('worker_threads')
+      const bindings = require(${JSON.stringify(require.resolve('../'))})
+      const options = { interval: 1 }
+      bindings.Config.getSettingsSnapshot(options)
+      parentPort.postMessage(options.writer)
+      parentPort.once('message', () => parentPort.close())
+    `
+    const worker = new Worker(code, { eval: true })
+    worker.on('message', writer => {
+      expect(writer).equal(true)
+      const options = { interval: 100 }
+      bindings.Config.getSettingsSnapshot(options)
+      expect(options.writer).equal(false, 'the worker is writing')
+      worker.postMessage('exit')
+    })
+    worker.on('error', done)
+    worker.on('exit', () => {
+      const options = { interval: 100 }
+      bindings.Config.getSettingsSnapshot(options)
+      expect(options.writer).equal(true, 'the main thread took over')
+      done()
+    })
+  })
+
+  it('should throw on a bad snapshot interval', function () {
+    expect(() => bindings.Config.getSettingsSnapshot({ interval: 'x' })).throw(TypeError)
+  })
 })
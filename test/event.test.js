@@ -223,4 +223,70 @@ describe('bindings.Event', function () {
     const bytes = event.getBytesAllocated()
     expect(bytes).equal(224 + 1024, 'should include a 1024 byte buffer')
   })
+
+  it('should parse and format W3C trace context headers', function () {
+    const traceparent = '00-0123456789abcdef0123456789abcdef-0011223344556677-01'
+    const tracestate = 'a=1, sw=8899aabbccddeeff-00,b=2'
+
+    for (const headers of [[traceparent, tracestate], [Buffer.from(traceparent), Buffer.from(tracestate)]]) {
+      const { event, sw } = bindings.Event.parseTraceContext(...headers)
+      expect(event).instanceof(bindings.Event)
+      expect(event.toTraceparent()).equal(traceparent)
+      expect(event.toString(1)).equal(traceparent)
+      expect(sw).equal('8899aabbccddeeff-00')
+    }
+
+    const zeros = '00-00000000000000000000000000000000-0011223344556677-01'
+    expect(bindings.Event.parseTraceContext(zeros, 'a=1')).deep.equal({ event: null, sw: null })
+    // only lowercase hex, and only version 00 is exactly 55 characters.
+    expect(bindings.Event.parseTraceContext(traceparent.toUpperCase()).event).equal(null)
+    expect(bindings.Event.parseTraceContext(`01${traceparent.slice(2)}`).event).equal(null)
+    expect(bindings.Event.parseTraceContext(`01${traceparent.slice(2)}-future`).event).instanceof(bindings.Event)
+
+    const { event } = bindings.Event.parseTraceContext(traceparent)
+    expect(event.toTracestate()).equal('sw=0011223344556677-01')
+    expect(event.toTracestate(tracestate)).equal('sw=0011223344556677-01,a=1,b=2')
+
+    const buffer = Buffer.alloc(100)
+    expect(event.writeTraceparent(buffer, 10)).equal(55)
+    expect(buffer.toString('latin1', 10, 65)).equal(traceparent)
+    const n = event.writeTracestate(buffer, 0, tracestate)
+    expect(buffer.toString('latin1', 0, n)).equal('sw=0011223344556677-01,a=1,b=2')
+    expect(event.writeTraceparent(buffer, 50)).equal(-1)
+    expect(() => event.writeTraceparent('x')).throws('buffer must be a Buffer or Uint8Array')
+  })
+
+  it('should generate random ids with the fast generator', function () {
+    bindings.oboeInit({ fastIds: { reseedInterval: 1000 } }, { skipInit: true })
+    try {
+      const seen = new Set()
+      for (let i = 0; i < 1000; i++) {
+        const event = bindings.Event.makeRandom(1)
+        expect(event.getSampleFlag()).equal(true)
+        seen.add(event.toString(1))
+      }
+      expect(seen.size).equal(1000)
+
+      const ids = bindings.Event.makeRandomBatch(100, true)
+      expect(ids.length).equal(100 * 26)
+      const event = bindings.Event.makeFromBuffer(ids.subarray(26, 52))
+      expect(event.toString(1)).equal('00-' + ids.toString('hex', 27, 43) + '-' + ids.toString('hex', 43, 51) + '-01')
+    } finally {
+      bindings.oboeInit({ fastIds: false }, { skipInit: true })
+    }
+  })
+
+  it('should benchmark the random id generators', function () {
+    const results = bindings.Event.benchmarkRandomIds(100000)
+    expect(results.oboe).gt(0)
+    expect(results.fast).gt(0)
+    // timings are only compared when benchmarks are asked for; a loaded
+    // machine can make either one slow.
+    if (process.env.SW_APM_TEST_BENCHMARKS) {
+      console.log(`[oboe_metadata_random() ${results.oboe.toFixed(1)}ns, fast ids ${results.fast.toFixed(1)}ns]`)
+      // the point of the fast generator; oboe reads the system's entropy
+      // source for every id.
+      expect(results.fast).lt(results.oboe)
+    }
+  })
 })
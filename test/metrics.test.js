@@ -0,0 +1,62 @@
+/* global describe, before, after, it */
+'use strict'
+
+const bindings = require('../')
+const expect = require('chai').expect
+
+const metrics = bindings.metrics
+
+describe('bindings.metrics', function () {
+  before(function () {
+    // index.js supplies stubs when the metrics addon isn't available.
+    if (!/native code/.test(metrics.start.toString())) {
+      this.skip()
+    }
+    metrics.start()
+  })
+
+  after(function () {
+    metrics.stopExporter()
+    metrics.stop()
+  })
+
+  it('should get interval metrics with histogram values', function (done) {
+    setTimeout(() => {
+      const m = metrics.getMetrics()
+      expect(m).to.have.property('eventloop')
+      expect(m.eventloop).to.include.all.keys('p50', 'p75', 'p90', 'p95', 'p99', 'min', 'max', 'mean', 'stddev')
+      expect(m.eventloop.max).gte(m.eventloop.p50)
+      done()
+    }, 100)
+  })
+
+  it('should validate the exporter options', function () {
+    expect(() => metrics.startExporter('60')).throws(TypeError, 'options must be an object')
+    expect(() => metrics.startExporter({ interval: 0 })).throws(RangeError, 'interval must be at least 1')
+    expect(metrics.getExporterStats().running).equal(false)
+  })
+
+  it('should not start the exporter when a tag throws', function () {
+    const tags = { get bad () { throw new Error('no tag') } }
+    expect(() => metrics.startExporter({ tags })).throws('no tag')
+    expect(metrics.getExporterStats().running).equal(false)
+  })
+
+  it('should start, submit and stop the exporter', function (done) {
+    this.timeout(5000)
+    expect(metrics.startExporter({ interval: 1, tags: { a: 'b' } })).equal(true)
+    expect(metrics.startExporter()).equal(false, 'already running')
+    expect(metrics.getExporterStats()).deep.equal({ running: true, ticks: 0, submitted: 0, failed: 0 })
+
+    setTimeout(() => {
+      const stats = metrics.getExporterStats()
+      expect(stats.ticks).gte(1)
+      expect(stats.submitted).gt(0)
+
+      expect(metrics.stopExporter()).equal(true)
+      expect(metrics.stopExporter()).equal(false, 'already stopped')
+      expect(metrics.getExporterStats().running).equal(false)
+      done()
+    }, 1500)
+  })
+})
@@ -2,6 +2,7 @@
 'use strict'
 
 const bindings = require('../')
+const fs = require('fs')
 const expect = require('chai').expect
 
 const maxIsReadyToSampleWait = 60000
@@ -79,6 +80,32 @@ describe('bindings.Reporter.sendMetrics()', function () {
     }
   })
 
+  it('should return compact errors as typed arrays', function () {
+    const metrics = [
+      'not an object',
+      { name: 'testing.node.compact' },
+      { count: 1 },
+      { name: 'testing.node.compact', count: -1 },
+      { name: 'testing.node.compact', value: 'x' }
+    ]
+
+    const results = bindings.Reporter.sendMetrics(metrics, { compactErrors: true, noop: true })
+    const { indexes, codes } = results.errors
+    expect(indexes).instanceOf(Uint32Array)
+    expect(codes).instanceOf(Uint8Array)
+    expect(Array.from(indexes)).deep.equal([0, 2, 3, 4])
+
+    const messages = Array.from(codes).map(bindings.Reporter.getMetricErrorMessage)
+    expect(messages).deep.equal([
+      'metric must be plain object',
+      'must have string name',
+      'count must be greater than 0',
+      'summary value must be numeric'
+    ])
+    expect(bindings.Reporter.getMetricErrorMessage(0)).equal(undefined)
+    expect(bindings.Reporter.getMetricErrorMessage(255)).equal(undefined)
+  })
+
   it('should handle correct metrics', function () {
     const metrics = [
       { name: 'testing.node.123' },
@@ -106,4 +133,152 @@ describe('bindings.Reporter.sendMetrics()', function () {
       expect(metric).deep.equal(expected)
     }
   })
+  it('should reuse prepared series from the series cache', function () {
+    bindings.oboeInit({ metricSeriesCache: { capacity: 2 } }, { skipInit: true })
+    const r = bindings.Reporter
+    try {
+      const metrics = [
+        { name: 'testing.node.cache', tags: { a: 1, b: 'x' } },
+        { name: 'testing.node.cache', tags: { b: 'x', a: 1 } },
+        { name: 'testing.node.cache', tags: { a: 1, b: 'x' }, service: 'svc' },
+        { name: 'testing.node.cache', tags: { a: 2, b: 'x' } }
+      ]
+      const results = r.sendMetrics(metrics, { testing: true, noop: true })
+      expect(results.errors).deep.equal([])
+      expect(results.correct[1].tags).deep.equal({ b: 'x', a: '1' })
+      expect(results.correct[2].service).equal('svc')
+
+      const stats = r.getSeriesCacheStats({ reset: true, clear: true })
+      expect(stats).deep.equal({ size: 2, capacity: 2, hits: 1, misses: 3, evictions: 1 })
+      expect(r.getSeriesCacheStats()).deep.equal({ size: 0, capacity: 2, hits: 0, misses: 0, evictions: 0 })
+    } finally {
+      bindings.oboeInit({ metricSeriesCache: { capacity: 1000 } }, { skipInit: true })
+    }
+  })
+
+  it('should aggregate metrics in shared memory', function () {
+    const r = bindings.Reporter
+    const name = `/solarwinds-apm-test-${process.pid}`
+    expect(r.getSharedMetricsStats()).equal(undefined, 'disabled by default')
+
+    const details = { skipInit: true }
+    bindings.oboeInit({ sharedMetrics: { slots: 5 } }, details)
+    expect(details.valid).not.property('sharedMetrics', 'a segment name is required')
+
+    bindings.oboeInit({ sharedMetrics: { name, slots: 5, interval: 0 } }, { skipInit: true })
+    try {
+      const metrics = [
+        { name: 'testing.node.shared', value: 1, tags: { a: 'b' } },
+        { name: 'testing.node.shared', value: 2, tags: { a: 'b' } },
+        { name: 'testing.node.shared', tags: { a: 'b' } },
+        { name: 'testing.node.shared.other' },
+        // tag keys and values are kept apart so these are different series.
+        { name: 'testing.node.shared.eq', tags: { a: 'b=c' } },
+        { name: 'testing.node.shared.eq', tags: { 'a=b': 'c' } }
+      ]
+      expect(r.sendMetrics(metrics).errors).deep.equal([])
+
+      const stats = r.getSharedMetricsStats()
+      expect(stats).deep.include({ name, slots: 8, used: 5, dropped: 0 })
+      expect(fs.existsSync(`/dev/shm${name}`)).equal(true)
+
+      expect(r.flushSharedMetrics()).equal(5)
+      expect(r.getSharedMetricsStats().leader).equal(process.pid)
+      expect(r.flushSharedMetrics()).equal(0, 'series are zeroed when flushed')
+    } finally {
+      bindings.oboeInit({ sharedMetrics: false }, { skipInit: true })
+    }
+    expect(r.getSharedMetricsStats()).equal(undefined)
+    expect(fs.existsSync(`/dev/shm${name}`)).equal(false, 'the last process to detach unlinks the segment')
+  })
+
+  it('should record distribution metrics natively', function () {
+    const details = { skipInit: true }
+    const distributions = { interval: 0, maxSeries: 2, percentiles: [50, 99.9] }
+    bindings.oboeInit({ distributions }, details)
+    expect(details.valid).deep.equal({ distributions })
+
+    const metrics = [
+      { name: 'testing.node.dist', value: 12.5, distribution: true },
+      { name: 'testing.node.dist', value: 15, count: 2, distribution: true, tags: { a: 'b', c: 'd' } },
+      { name: 'testing.node.dist', value: 17, distribution: true, tags: { c: 'd', a: 'b' } },
+      { name: 'testing.node.dist', value: 1, distribution: true, addHostTag: true },
+      { name: 'testing.node.dist', distribution: true },
+      { name: 'testing.node.dist', value: -1, distribution: true, tags: { x: 'y' } }
+    ]
+    const results = bindings.Reporter.sendMetrics(metrics)
+    expect(results.errors.map(e => e.code)).deep.equal([
+      'distribution series limit exceeded',
+      'distribution requires a value',
+      'distribution value must not be negative'
+    ])
+    expect(results.errors[0].metric).equal(metrics[3])
+
+    expect(bindings.Reporter.getDistributionStats()).deep.equal({ series: 2, maxSeries: 2 })
+    // a value with a count is the sum of count observations, each recorded
+    // as the mean.
+    const values = bindings.Reporter.getDistributionStats({ values: true }).values
+    const tagged = values.find(v => v.tags.a === 'b')
+    expect(tagged).deep.include({ name: 'testing.node.dist', count: 3, sum: 32 })
+    expect(tagged.max).closeTo(17, 0.1)
+    const untagged = values.find(v => !Object.keys(v.tags).length)
+    expect(untagged).deep.include({ count: 1, sum: 12.5 })
+
+    bindings.Reporter.sendMetrics([{ name: 'testing.node.dist', value: 15, count: 2, distribution: true }])
+    const mean = bindings.Reporter.getDistributionStats({ values: true }).values.find(v => !Object.keys(v.tags).length)
+    expect(mean).deep.include({ count: 3, sum: 27.5 })
+    expect(mean.max).closeTo(12.5, 0.1, 'the mean of 15 over 2 is 7.5, not 15')
+
+    expect(bindings.Reporter.flushDistributions()).equal(2)
+    // series without observations since the last flush are discarded.
+    expect(bindings.Reporter.flushDistributions()).equal(0)
+    expect(bindings.Reporter.getDistributionStats().series).equal(0)
+  })
+  it('should fold or reject metric series over the cardinality limit', function () {
+    const tagged = (id) => ({ name: 'testing.node.card', tags: { requestId: `${id}`, a: 'b' } })
+
+    bindings.oboeInit({ metricCardinality: { maxSeries: 2 } }, { skipInit: true })
+    try {
+      let results = bindings.Reporter.sendMetrics([tagged(1), tagged(2), tagged(1), tagged(3)], { testing: true })
+      expect(results.errors).deep.equal([])
+      expect(results.correct.map(m => m.tags.requestId)).deep.equal(['1', '2', '1', 'other'])
+
+      bindings.oboeInit({ metricCardinality: { maxSeries: 2, overflow: 'reject' } }, { skipInit: true })
+      results = bindings.Reporter.sendMetrics([tagged(1), tagged(2), tagged(3), tagged(4)])
+      expect(results.errors.length).equal(2)
+      expect(results.errors[0].code).equal('metric rejected: cardinality limit exceeded')
+
+      const stats = bindings.Reporter.getCardinalityStats({ reset: true })
+      expect(stats.rejected).equal(2)
+      expect(stats.names['testing.node.card']).deep.equal({ series: 2, estimate: 4, folded: 0, rejected: 2 })
+      expect(bindings.Reporter.getCardinalityStats().rejected).equal(0)
+    } finally {
+      bindings.oboeInit({ metricCardinality: false }, { skipInit: true })
+    }
+  })
+  it('should keep exemplars of metric series', function () {
+    bindings.Reporter.getMetricExemplars({ reset: true })
+
+    const traceId = 'c'.repeat(32)
+    const metrics = [
+      { name: 'testing.node.exemplar', value: 10, exemplar: traceId, tags: { a: 'b' } },
+      { name: 'testing.node.exemplar', value: 30, exemplar: bindings.Event.makeRandom(1), tags: { a: 'b' } },
+      { name: 'testing.node.exemplar', value: 20, exemplar: `00-${'d'.repeat(32)}-${'e'.repeat(16)}-00`, tags: { a: 'b' } },
+      { name: 'testing.node.exemplar.count', exemplar: 'not a trace id' }
+    ]
+    const results = bindings.Reporter.sendMetrics(metrics, { testing: true })
+    expect(results.errors).deep.equal([], 'invalid exemplars are ignored')
+    expect(results.correct[0].exemplar).equal(traceId)
+    expect(results.correct[3]).not.have.property('exemplar')
+
+    const { series, untracked } = bindings.Reporter.getMetricExemplars({ reset: true })
+    expect(untracked).equal(0)
+    expect(series.length).equal(1)
+    expect(series[0].name).equal('testing.node.exemplar')
+    expect(series[0].tags).deep.equal({ a: 'b' })
+    expect(series[0].exemplars.max.value).equal(30)
+    expect(series[0].exemplars.latest.value).equal(30, 'unsampled traceparents are not kept')
+
+    expect(bindings.Reporter.getMetricExemplars().series).deep.equal([])
+  })
 })
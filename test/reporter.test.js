@@ -105,6 +105,275 @@ describe('bindings.Reporter', function () {
     expect(finalTxName).equal(domain + '/' + customName)
   })
 
+  it('should send an array of HTTP spans', function () {
+    const domain = 'bruce.com'
+    const spans = [
+      { url: '/api/todo', status: 200, method: 'GET', duration: 1111 },
+      { url: '/api/todo', domain, duration: 1112 },
+      { url: '/api/todo', status: 201, method: 'POST', duration: 1113 },
+      'not a span'
+    ]
+
+    const result = r.sendHttpSpans(spans)
+    expect(result.txnames).deep.equal(['/api/todo', domain + '/api/todo'])
+    expect(result.indexes).instanceOf(Int32Array)
+    expect(Array.from(result.indexes)).deep.equal([0, 1, 0, -1])
+  })
+
+  it('should send columns of non-HTTP spans', function () {
+    const customName = 'this-is-a-name'
+    const domain = 'bruce.com'
+
+    const result = r.sendNonHttpSpans({
+      strings: [customName, domain],
+      duration: new Float64Array([1001, 1002, 1003]),
+      txname: new Int32Array([0, 0, -1]),
+      domain: new Int32Array([-1, 1, -1])
+    })
+    expect(result.txnames).deep.equal([customName, domain + '/' + customName, 'unknown'])
+    expect(Array.from(result.indexes)).deep.equal([0, 1, 2])
+  })
+
+  it('should reject invalid span columns', function () {
+    expect(() => r.sendHttpSpans({ duration: [1, 2] })).throws('duration must be a Float64Array')
+    expect(() => r.sendHttpSpans({
+      duration: new Float64Array(2),
+      status: new Int32Array(1)
+    })).throws('invalid column')
+  })
+
+  it('should return the same string for a repeated transaction name', function () {
+    r.getTxnameCacheStats({ reset: true, clear: true })
+
+    const span = { url: '/api/cached', duration: 1001 }
+    expect(r.sendHttpSpan(span)).equal('/api/cached')
+    expect(r.sendHttpSpan(span)).equal('/api/cached')
+
+    const stats = r.getTxnameCacheStats()
+    expect(stats).to.have.all.keys('size', 'capacity', 'hits', 'misses', 'hitRatio')
+    expect(stats.size).equal(1)
+    expect(stats.hits).equal(1)
+    expect(stats.misses).equal(1)
+    expect(stats.hitRatio).equal(0.5)
+  })
+
+  it('should return cached transaction names from the span batches', function () {
+    r.getTxnameCacheStats({ reset: true, clear: true })
+
+    const spans = [{ url: '/api/batched', duration: 1001 }]
+    expect(r.sendHttpSpans(spans).txnames).deep.equal(['/api/batched'])
+    expect(r.sendHttpSpans(spans).txnames).deep.equal(['/api/batched'])
+
+    const columns = { strings: ['batched'], duration: new Float64Array([1002]), txname: new Int32Array([0]) }
+    expect(r.sendNonHttpSpans(columns).txnames).deep.equal(['batched'])
+    expect(r.sendNonHttpSpans(columns).txnames).deep.equal(['batched'])
+
+    const stats = r.getTxnameCacheStats()
+    expect(stats.size).equal(2)
+    expect(stats.hits).equal(2)
+    expect(stats.misses).equal(2)
+  })
+
+  it('should keep a separate transaction name cache in a worker', function (done) {
+    const { Worker } = require('worker_threads')
+    r.sendHttpSpan({ url: '/api/main-thread', duration: 1001 })
+
+    const code = `
+      const { parentPort } = require('worker_threads')
+      const r = require(${JSON.stringify(require.resolve('../'))}).Reporter
+      const before = r.getTxnameCacheStats().size
+      r.sendHttpSpan({ url: '/api/worker', duration: 1001 })
+      parentPort.postMessage({ before, txname: r.sendHttpSpan({ url: '/api/worker', duration: 1002 }) })
+    `
+    const worker = new Worker(code, { eval: true })
+    worker.on('message', m => {
+      expect(m.before).equal(0)
+      expect(m.txname).equal('/api/worker')
+      expect(r.getTxnameCacheStats().size).gte(1)
+    })
+    worker.on('error', done)
+    worker.on('exit', code => done(code ? new Error(`worker exited with ${code}`) : undefined))
+  })
+
+  it('should normalize urls when there is no transaction name', function () {
+    const details = {}
+    const txnameNormalizer = { templates: ['/items/:id'] }
+    bindings.oboeInit({ txnameNormalizer }, Object.assign(details, { skipInit: true }))
+    expect(details.valid).deep.equal({ txnameNormalizer })
+
+    try {
+      expect(r.sendHttpSpan({ url: '/orders/12345', duration: 1001 })).equal('/orders/:id')
+      expect(r.sendHttpSpan({ url: '/items/abc?x=y', duration: 1002 })).equal('/items/:id')
+      // an explicit transaction name is left alone
+      expect(r.sendHttpSpan({ txname: 'explicit', url: '/orders/1', duration: 1003 })).equal('explicit')
+    } finally {
+      bindings.oboeInit({ txnameNormalizer: false }, { skipInit: true })
+    }
+
+    expect(r.sendHttpSpan({ url: '/orders/12345', duration: 1004 })).equal('/orders/12345')
+  })
+
+  it('should mark urls with more segments than the normalizer keeps', function () {
+    bindings.oboeInit({ txnameNormalizer: { templates: ['/items/:id', '/static/*'], maxSegments: 2 } }, { skipInit: true })
+    try {
+      expect(r.sendHttpSpan({ url: '/items/1', duration: 1001 })).equal('/items/:id')
+      expect(r.sendHttpSpan({ url: '/items/1/parts', duration: 1002 })).equal('/items/:id/*')
+      expect(r.sendHttpSpan({ url: '/static/js/app.js', duration: 1003 })).equal('/static/*')
+    } finally {
+      bindings.oboeInit({ txnameNormalizer: false }, { skipInit: true })
+    }
+  })
+
+  it('should reject invalid normalizer templates', function () {
+    const details = { skipInit: true }
+    bindings.oboeInit({ txnameNormalizer: { templates: ['no-leading-slash'] } }, details)
+    expect(details.valid).deep.equal({})
+    bindings.oboeInit({ txnameNormalizer: { templates: ['/a/*/b'] } }, details)
+    expect(details.valid).deep.equal({})
+  })
+
+  it('should keep span histograms per transaction', function () {
+    expect(r.getSpanHistograms()).equal(undefined, 'disabled by default')
+
+    bindings.oboeInit({ spanHistograms: { maxTransactions: 2 } }, { skipInit: true })
+
+    r.sendHttpSpan({ url: '/hist/a', duration: 1000 })
+    r.sendHttpSpan({ url: '/hist/a', duration: 3000, error: true })
+    r.sendHttpSpan({ url: '/hist/b', duration: 2000 })
+    r.sendHttpSpan({ url: '/hist/c', duration: 4000 })
+
+    let h = r.getSpanHistograms({ reset: true })
+    expect(h).to.have.all.keys('all', 'transactions', 'untracked')
+    expect(h.all).to.have.all.keys(
+      'count', 'errors', 'p50', 'p75', 'p90', 'p95', 'p99', 'min', 'max', 'mean', 'stddev', 'exemplars'
+    )
+    expect(h.all.count).equal(4)
+    expect(h.all.errors).equal(1)
+    expect(h.transactions).to.have.all.keys('/hist/a', '/hist/b')
+    expect(h.transactions['/hist/a'].count).equal(2)
+    expect(h.transactions['/hist/a'].errors).equal(1)
+    expect(h.transactions['/hist/a'].max).within(2990, 3010)
+    expect(h.untracked).equal(1)
+
+    h = r.getSpanHistograms()
+    expect(h.all.count).equal(0, 'reset should start a new interval')
+    expect(h.transactions).deep.equal({})
+
+    bindings.oboeInit({ spanHistograms: false }, { skipInit: true })
+  })
+
+  it('should keep span exemplars with the histograms', function () {
+    bindings.oboeInit({ spanHistograms: true }, { skipInit: true })
+
+    const sampled = bindings.Event.makeRandom(1)
+    const traceId = sampled.toString(1).split('-')[1].toLowerCase()
+    const traceparent = `00-${'a'.repeat(32)}-${'b'.repeat(16)}-01`
+
+    r.sendHttpSpan({ url: '/exemplar/a', duration: 5000, exemplar: sampled })
+    r.sendHttpSpan({ url: '/exemplar/a', duration: 1000, exemplar: traceparent })
+    r.sendHttpSpan({ url: '/exemplar/a', duration: 9000, exemplar: bindings.Event.makeRandom(0) })
+    r.sendHttpSpan({ url: '/exemplar/b', duration: 1000 })
+
+    const h = r.getSpanHistograms({ reset: true })
+    const exemplars = h.transactions['/exemplar/a'].exemplars
+    expect(exemplars.max.traceId).equal(traceId)
+    expect(exemplars.max.value).equal(5000)
+    expect(exemplars.latest.traceId).equal('a'.repeat(32))
+    expect(exemplars.latest.timestamp).within(Date.now() - 1000, Date.now())
+    expect(h.transactions['/exemplar/b'].exemplars).equal(null)
+
+    bindings.oboeInit({ spanHistograms: false }, { skipInit: true })
+  })
+
+  it('should count the top transactions', function () {
+    expect(r.getTopTransactions()).equal(undefined, 'disabled by default')
+
+    bindings.oboeInit({ topTransactions: { capacity: 2 } }, { skipInit: true })
+
+    r.sendHttpSpan({ url: '/top/a', duration: 1000 })
+    r.sendHttpSpan({ url: '/top/a', duration: 2000 })
+    r.sendHttpSpan({ url: '/top/a', duration: 3000 })
+    r.sendHttpSpan({ url: '/top/b', duration: 1000 })
+    r.sendHttpSpan({ url: '/top/c', duration: 500 })
+
+    let top = r.getTopTransactions(1)
+    expect(top).deep.equal([{ name: '/top/a', count: 3, error: 0, duration: 6000 }])
+
+    // /top/c replaced /top/b and inherited its count as the error.
+    top = r.getTopTransactions(10, { reset: true })
+    expect(top.length).equal(2)
+    expect(top[1]).deep.equal({ name: '/top/c', count: 2, error: 1, duration: 500 })
+
+    expect(r.getTopTransactions()).deep.equal([])
+
+    bindings.oboeInit({ topTransactions: false }, { skipInit: true })
+  })
+
+  it('should flush asynchronously', async function () {
+    const result = await r.flushAsync()
+    expect(result).to.have.all.keys('status', 'timedOut', 'elapsed')
+    expect(result.status).a('number')
+    expect(result.timedOut).equal(false)
+    expect(result.elapsed).gte(0)
+  })
+
+  it('should flush asynchronously with a deadline', async function () {
+    // the flush can't finish before the deadline.
+    process.env.SW_APM_TEST_FLUSH_STALL_MS = '300'
+    let result
+    try {
+      result = await r.flushAsync({ timeoutMs: 10 })
+    } finally {
+      delete process.env.SW_APM_TEST_FLUSH_STALL_MS
+    }
+    expect(result.timedOut).equal(true)
+    expect(result.status).equal(-1)
+    expect(result.elapsed).gte(10).lt(300)
+
+    // a second flush waits for the one still running.
+    const second = await r.flushAsync()
+    expect(second.timedOut).equal(false)
+    expect(second.elapsed).gt(0)
+
+    expect(() => r.flushAsync({ timeoutMs: 'soon' })).throws('timeoutMs must be a number')
+  })
+
+  it('should shed low-priority events and metrics under back-pressure', function () {
+    expect(r.pressure()).equal(0, 'no pressure without watermarks')
+
+    // a low watermark above any possible queue size means the queue is
+    // always under pressure.
+    const backpressure = { lowWatermark: 1e9, refreshMs: 0 }
+    bindings.oboeInit({ backpressure }, { skipInit: true })
+    r.getPressureStats({ reset: true })
+
+    try {
+      expect(r.pressure()).equal(1)
+
+      const root = bindings.Event.makeRandom(1)
+      const info = new bindings.Event(root, true)
+      info.addInfo('Label', 'info')
+      expect(info.sendReport()).equal(-3000, 'non-root info events should be dropped')
+
+      const entry = new bindings.Event(root, false)
+      entry.addInfo('Label', 'entry')
+      expect(entry.sendReport()).not.equal(-3000, 'root events should be sent')
+
+      bindings.oboeInit({ backpressure: { criticalWatermark: 1e9, refreshMs: 0 } }, { skipInit: true })
+      expect(r.pressure()).equal(2)
+      const result = r.sendMetrics([{ name: 'dropped.metric' }])
+      expect(result.errors.length).equal(1)
+      expect(result.errors[0].code).equal('metric dropped: reporter queue full')
+
+      const stats = r.getPressureStats()
+      expect(stats.droppedEvents).equal(1)
+      expect(stats.droppedMetrics).equal(1)
+    } finally {
+      bindings.oboeInit({ backpressure: false }, { skipInit: true })
+    }
+    expect(r.pressure()).equal(0)
+  })
+
   it('should not crash node getting the prototype of a reporter instance', function () {
     // eslint-disable-next-line no-unused-vars
     const p = Object.getPrototypeOf(r)
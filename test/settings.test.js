@@ -149,6 +149,211 @@ describe('bindings.Settings', function () {
     }, 50)
   })
 
+  it('should accept the xtrace and tracestate as bytes', function () {
+    const event = new bindings.Event(bindings.Event.makeRandom(0))
+    const xtrace = event.toString()
+    const tracestate = xtrace.split('-').slice(2).join('-')
+    const expected = bindings.Settings.getTraceSettings({ xtrace, tracestate })
+
+    // a slice of a larger buffer, as a header parser would supply.
+    const headers = Buffer.from(`traceparent: ${xtrace}\r\ntracestate: sw=${tracestate}\r\n`)
+    const start = headers.indexOf(xtrace)
+    const tsStart = headers.indexOf(tracestate)
+    const settings = bindings.Settings.getTraceSettings({
+      xtrace: headers.subarray(start, start + xtrace.length),
+      tracestate: new Uint8Array(headers.buffer, headers.byteOffset + tsStart, tracestate.length)
+    })
+    expect(settings).property('status', expected.status)
+    expect(settings).property('metadataFromXtrace', true)
+    expect(settings.metadata.toString()).equal(xtrace)
+
+    const bad = Buffer.from(xtrace.replace(/-/g, '_'))
+    expect(bindings.Settings.getTraceSettings({ xtrace: bad })).property('metadataFromXtrace', false)
+  })
+
+  it('should only accept traceparents that oboe accepts', function () {
+    const xtrace = '00-0123456789abcdef0123456789abcdef-0011223344556677-01'
+    expect(bindings.Settings.getTraceSettings({ xtrace })).property('metadataFromXtrace', true)
+    for (const bad of [
+      xtrace.toUpperCase(),
+      `01${xtrace.slice(2)}`,
+      '00-00000000000000000000000000000000-0011223344556677-01',
+      '00-0123456789abcdef0123456789abcdef-0000000000000000-01'
+    ]) {
+      expect(bindings.Settings.getTraceSettings({ xtrace: bad })).property('metadataFromXtrace', false, bad)
+    }
+  })
+
+  it('should not accept an xtrace that is truncated to a valid length', function () {
+    const xtrace = `2B${'a1'.repeat(20)}${'b2'.repeat(8)}01`
+    expect(xtrace.length).equal(60)
+    // the four byte character doesn't fit in the xtrace buffer.
+    const settings = bindings.Settings.getTraceSettings({ xtrace: `${xtrace}\u{1f600}` })
+    expect(settings).property('metadataFromXtrace', false)
+  })
+
+  it('should write trace settings into a typed array', function () {
+    const f = bindings.Settings.traceSettingsFields
+    const event = new bindings.Event(bindings.Event.makeRandom(0))
+    const xtrace = event.toString()
+    const options = { xtrace, tracestate: xtrace.split('-').slice(2).join('-') }
+    const expected = bindings.Settings.getTraceSettings(options)
+
+    for (const fields of [new Float64Array(f.length), new Int32Array(f.length)]) {
+      const md = bindings.Settings.getTraceSettingsInto(options, fields)
+      expect(md).instanceof(bindings.Event)
+      expect(md.toString()).equal(xtrace)
+      expect(fields[f.status]).equal(expected.status)
+      expect(fields[f.doSample]).equal(0)
+      expect(fields[f.edge]).equal(1)
+      expect(fields[f.metadataFromXtrace]).equal(1)
+      expect(bindings.Settings.getTraceSettingsMessage(fields[f.status])).equal(expected.message)
+      expect(bindings.Settings.getTraceSettingsAuthMessage(fields[f.authStatus])).equal(expected.authMessage)
+    }
+
+    expect(() => bindings.Settings.getTraceSettingsInto(options, [])).throws('fields must be an Int32Array or Float64Array')
+    expect(() => bindings.Settings.getTraceSettingsInto(options, new Float64Array(2))).throws('fields is too short')
+  })
+
+  it('should make a batch of trace decisions', function () {
+    const xtraces = [0, 1, 0].map(s => new bindings.Event(bindings.Event.makeRandom(s)).toString())
+    const entries = [
+      xtraces[0],
+      Buffer.from(xtraces[1]),
+      { xtrace: xtraces[2], tracestate: xtraces[2].split('-').slice(2).join('-') },
+      {}
+    ]
+    const results = bindings.Settings.getTraceSettingsBatch(entries)
+    expect(results.status).instanceof(Int32Array)
+    expect(results.status.length).equal(4)
+    expect(results.doSample.length).equal(1)
+    expect(results.metadata.length).equal(4 * 26)
+
+    entries.forEach((entry, i) => {
+      const expected = bindings.Settings.getTraceSettings(typeof entry === 'object' && !Buffer.isBuffer(entry) ? entry : { xtrace: entry.toString() })
+      expect(results.status[i]).equal(expected.status)
+      expect(Boolean(results.edge[0] & (1 << i))).equal(expected.edge)
+      if (i < 3) {
+        const md = bindings.Event.makeFromBuffer(results.metadata.subarray(i * 26, i * 26 + 26))
+        expect(md.toString().slice(0, -2)).equal(xtraces[i].slice(0, -2))
+      }
+    })
+    // the non-sampled xtrace isn't sampled.
+    expect(results.doSample[0] & 1).equal(0)
+
+    expect(() => bindings.Settings.getTraceSettingsBatch('x')).throws('entries must be an array')
+  })
+
+  it('should apply route-level sampling policies', function () {
+    const policies = [
+      { route: '/never/*', mode: bindings.TRACE_NEVER },
+      { route: '/health', rate: 0 },
+      { route: '*' }
+    ]
+    expect(bindings.Settings.setSamplingPolicies(policies)).equal(3)
+    try {
+      expect(bindings.Settings.matchSamplingPolicy('/never/x?y=1')).equal(0)
+      expect(bindings.Settings.matchSamplingPolicy(Buffer.from('http://host/health'))).equal(1)
+      expect(bindings.Settings.matchSamplingPolicy('/healthz')).equal(2)
+      expect(bindings.Settings.matchSamplingPolicy('HTTPS://host:443/never/x#y')).equal(0)
+      // a url in the query isn't the request's own.
+      expect(bindings.Settings.matchSamplingPolicy('/login?next=https://host/health')).equal(2)
+      expect(bindings.Settings.matchSamplingPolicy('http://host?next=/health')).equal(2)
+
+      for (const options of [{ url: '/never/x' }, { policy: 0 }]) {
+        const settings = bindings.Settings.getTraceSettings(options)
+        expect(settings).property('status', -2) // tracing disabled
+        expect(settings).property('doSample', false)
+      }
+      // the caller's mode takes precedence.
+      expect(bindings.Settings.getTraceSettings({ url: '/never/x', mode: bindings.TRACE_ALWAYS }).status).not.equal(-2)
+
+      expect(() => bindings.Settings.setSamplingPolicies([{ route: '/x', rate: -1 }])).throws('invalid policy at index 0')
+    } finally {
+      expect(bindings.Settings.setSamplingPolicies([])).equal(0)
+    }
+    expect(bindings.Settings.matchSamplingPolicy('/never/x')).equal(-1)
+  })
+
+  it('should scale the sample rate down when the event loop lags', async function () {
+    const details = { skipInit: true }
+    bindings.oboeInit({ adaptiveSampling: { lowLag: 10, highLag: 5 } }, details)
+    expect(details.processed).property('adaptiveSampling')
+    expect(details.valid).not.property('adaptiveSampling')
+
+    bindings.oboeInit({ adaptiveSampling: { highLag: 5, lowLag: 1, interval: 1, window: 10 } }, { skipInit: true })
+    try {
+      expect(bindings.Settings.getAdaptiveSampling()).property('enabled', true)
+      // block the event loop so the lag timer fires late.
+      for (let i = 0; i < 10; i++) {
+        const end = Date.now() + 30
+        while (Date.now() < end);
+        await new Promise(resolve => setTimeout(resolve, 15))
+      }
+      const state = bindings.Settings.getAdaptiveSampling({ reset: true })
+      expect(state.multiplier).lt(1)
+      expect(state.decreases).gte(1)
+      expect(state.lagP99).gt(5)
+      // oboe's own rate is scaled without it being reported as a custom rate.
+      expect(bindings.Settings.getTraceSettings({}).source).not.equal(7)
+    } finally {
+      bindings.oboeInit({ adaptiveSampling: false }, { skipInit: true })
+    }
+    const state = bindings.Settings.getAdaptiveSampling()
+    expect(state).property('enabled', false)
+    expect(state).property('multiplier', 1)
+  })
+
+  it('should record the latency of tracing decisions', function () {
+    bindings.Settings.getDecisionStats({ reset: true })
+    for (let i = 0; i < 10; i++) {
+      bindings.Settings.getTraceSettings({})
+    }
+    const stats = bindings.Settings.getDecisionStats({ reset: true })
+    expect(stats.total.count).equal(10)
+    expect(stats.total).to.have.all.keys('count', 'min', 'p50', 'p90', 'p99', 'p999', 'max')
+    expect(stats.total.max).gte(stats.total.p50)
+    const counts = Object.values(stats.statuses).map(s => s.count)
+    expect(counts.reduce((a, b) => a + b)).equal(10)
+    Object.values(stats.statuses).forEach(s => expect(s.message).a('string'))
+
+    expect(bindings.Settings.getDecisionStats()).deep.equal({ total: null, statuses: {} })
+  })
+
+  it('should cache rejected trigger trace signatures', function () {
+    bindings.oboeInit({ signatureCache: { capacity: 10 } }, { skipInit: true })
+    try {
+      const options = {
+        typeRequested: 1,
+        xtraceOpts: 'trigger-trace;ts=' + Math.floor(Date.now() / 1000),
+        xtraceOptsSig: '0123456789abcdef0123456789abcdef01234567',
+        xtraceOptsTimestamp: Math.floor(Date.now() / 1000)
+      }
+      bindings.Settings.getSignatureCacheStats({ reset: true })
+      const first = bindings.Settings.getTraceSettings(options)
+      const second = bindings.Settings.getTraceSettings(options)
+      expect(second.status).equal(first.status)
+      expect(second.authStatus).equal(first.authStatus)
+      expect(second.authMessage).equal(first.authMessage)
+      expect(second.doSample).equal(false)
+
+      // only invalid (2) signatures are cached; without a key oboe can't
+      // verify anything.
+      const rejected = first.authStatus === 2
+      const stats = bindings.Settings.getSignatureCacheStats()
+      expect(stats).deep.include({ size: rejected ? 1 : 0, misses: 1, hits: rejected ? 1 : 0 })
+
+      // a rejected request still continues its own trace, unsampled.
+      const xtrace = '00-0123456789abcdef0123456789abcdef-0011223344556677-01'
+      const third = bindings.Settings.getTraceSettings(Object.assign({ xtrace }, options))
+      expect(third.authStatus).equal(first.authStatus)
+      expect(third).property('metadataFromXtrace', true)
+      expect(third.metadata.toString().split('-')[1]).equal(xtrace.split('-')[1])
+    } finally {
+      bindings.oboeInit({ signatureCache: false }, { skipInit: true })
+    }
+  })
+
   it('should not set sample bit unless specified', function () {
     const md0 = bindings.Event.makeRandom(0)
     const md1 = bindings.Event.makeRandom(1)